@@ -75,6 +75,8 @@
 	#define	PIN_IF	(uint8_t)0x30
 	//Interrupt low level
 	#define	PIN_IL	(uint8_t)0x50
+	//Analog input. Interrupt and digital input buffer disabled
+	#define	PIN_A	(uint8_t)0x40
 
 	/****************************************************************************
 	**	MACRO
@@ -109,6 +111,10 @@
 	#define COND_INT( pin )	\
 		( ((pin) == PIN_IE) | ((pin) == PIN_IR) | ((pin) == PIN_IF) | ((pin) == PIN_IL) )
 
+	//return true if the digital input buffer should be disabled
+	#define COND_ANALOG( pin )	\
+		((pin) == PIN_A)
+
 	
 
 	//Configure direction register of the port
@@ -145,7 +151,7 @@
 							SHL( COND_SLEW_RATE( pin7 ), 7)
 	
 	#define PIN_CONFIG_HW( PINyCTRL, pin_config )	\
-		PINyCTRL = SHL(COND_INV( pin_config ), 7) | SHL(COND_PULL( pin_config ), 3) | (0x07 & SHR(COND_INT( pin_config ), 4)) 
+		PINyCTRL = SHL(COND_INV( pin_config ), 7) | SHL(COND_PULL( pin_config ), 3) | ((COND_INT( pin_config ) | COND_ANALOG( pin_config ))?(0x07 & SHR( (pin_config), 4 )):(0))
 
 	//Configure individual pin hardware
 	#define PORT_CONFIG_PINHW( PORTx, pin0, pin1, pin2, pin3, pin4, pin5, pin6, pin7 )	\
@@ -611,15 +611,37 @@
 	**	AT_OCR_ROUND
 	********************************************
 	**	choose the correct M between M and M+1
-	**	>M' = f(2*fout)
-	**	>M' even?
-	**		>M = f(fout)
+	**	>M' = f(2*fin), one more bit of the quotient
+	**	>M' odd? the quotient has fraction < 0.5
+	**		>M = f(fin)
 	**	>else
-	**		>M = f(fout) +1
+	**		>M = f(fin) +1
 	*******************************************/
 
 	#define AT_OCR_ROUND( fin, fout, n, k)	\
-		(( AT_OCR((fin),(fout)*2,(n),(k)) & 1 )?( 1 +AT_OCR((fin),(fout),(n),(k)) ):(AT_OCR((fin),(fout),(n),(k))))
+		(( AT_OCR((fin)*2,(fout),(n),(k)) & 1 )?( AT_OCR((fin),(fout),(n),(k)) ):( 1 +AT_OCR((fin),(fout),(n),(k)) ))
+
+	/*******************************************
+	**	at_prescaler_solve
+	********************************************
+	**	Compile time prescaler choice
+	**
+	**	shift [1]	= table of the N of the prescalers, ascending
+	**	num [1]		= number of prescalers in the table
+	**	top_max [1]	= largest M the counter can hold
+	**
+	**	Returns the index of the smallest prescaler
+	**	whose AT_OCR_ROUND M fits top_max, which is
+	**	the one with the finest resolution.
+	**	Returns num if no prescaler fits
+	*******************************************/
+
+	constexpr uint8_t at_prescaler_solve( uint32_t fin, uint32_t fout, const uint8_t *shift, uint8_t num, uint32_t top_max, uint8_t index = 0 )
+	{
+		return	(index >= num)?(num):
+				((uint32_t)AT_OCR_ROUND( fin, fout, shift[index], 0 ) <= top_max)?(index):
+				(at_prescaler_solve( fin, fout, shift, num, top_max, index +1 ));
+	}
 
 		///********************************************************************************
 		///	AT_ABS
@@ -0,0 +1,433 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	CURRENT SENSE
+*****************************************************************
+**	Motor currents from the MultiSense outputs of the VNH7040.
+**	SEN (PF0) enables the outputs, SEL1 (PF1) low and SEL0 = INA
+**	select the current of the active high side.
+**	The sense of DRV0..3 is on AIN0..3 (PD0..3), see init_pin.
+**
+**		ADC
+**	ADC0 runs free, see init_adc. Each result is the sum of 8
+**	conversions done in hardware. The ADC ISR adds the result to
+**	the running sum of its channel and programs the channel
+**	after the next one, because the next conversion has
+**	already started when the result is ready.
+**	A running sum holds at most CURRENT_SUM_MAX_NUM results,
+**	later ones are dropped until the sum is consumed.
+**	The ISR never waits and the main loop never polls the ADC.
+**	During the diagnostic window of diag.cpp the results belong
+**	to the diagnostic and are not summed.
+**
+**		FILTER
+**	update_current runs every system tick. It takes the sums,
+**	decimates them to the average of the tick and runs a first
+**	order low pass filter. Motor currents are published in mA
+**
+**		CURRENT LIMIT
+**	update_pwm passes the output of the ramp generator through
+**	current_limit_step before it reaches the driver.
+**	Limit loop: while the filtered current is above the limit of
+**	the motor, the PWM scale shrinks in proportion to the excess.
+**	Below the limit the scale recovers by a fixed step per tick.
+**	Fast trip: the ADC ISR compares every result against the trip
+**	threshold of the channel. Above it, the ISR zeroes the PWM
+**	timer of the driver at once. The motor stays off for
+**	CURRENT_TRIP_HOLD ticks, then restarts from zero PWM scale
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Running sums of the ADC results. Written by the ADC ISR
+volatile uint16_t g_adc_sum[DC_MOTOR_NUM];
+//Number of ADC results inside the running sums
+volatile uint8_t g_adc_num[DC_MOTOR_NUM];
+//Channel of the next ADC result. CURRENT_ADC_CH_BOOT until the first result
+volatile uint8_t g_adc_ch;
+
+//Low pass filter of the sense of the motors. ADC results. Q3
+uint16_t current_filter[DC_MOTOR_NUM];
+//Filtered motor currents. mA
+uint16_t motor_current[DC_MOTOR_NUM];
+
+//Trip thresholds as ADC results. Read by the ADC ISR. 0xffff = disabled
+volatile uint16_t g_adc_trip[DC_MOTOR_NUM];
+//bit n = the ADC ISR tripped motor n
+volatile uint8_t g_adc_trip_mask;
+//Current limit stage of the motors
+Current_limit current_limit;
+
+/****************************************************************************
+**  Function
+**  init_current
+****************************************************************************/
+//! @return void |
+//! @brief Initialize running sums and filters of the motor currents
+//! @details Must be called before init_adc starts the conversions.
+//!	The first conversion and the one already started when its result is ready
+//!	are both on AIN0. The first is accounted to the last channel, motors are still off
+/***************************************************************************/
+
+void init_current( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		g_adc_sum[t] = 0;
+		g_adc_num[t] = 0;
+		current_filter[t] = 0;
+		motor_current[t] = 0;
+		g_adc_trip[t] = current_trip_adc( CURRENT_TRIP_MA );
+		current_limit.limit[t] = CURRENT_LIMIT_MA;
+		current_limit.trip[t] = CURRENT_TRIP_MA;
+		current_limit.scale[t] = CURRENT_SCALE_FULL;
+		current_limit.hold[t] = 0;
+	}
+	//The first result is discarded. See adc_isr
+	g_adc_ch = CURRENT_ADC_CH_BOOT;
+	g_adc_trip_mask = 0;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_current
+
+/****************************************************************************
+**  Function
+**  update_current
+****************************************************************************/
+//! @return void |
+//! @brief Decimate the ADC running sums and filter the motor currents
+//! @details Called every system tick. A channel without results keeps its last value
+/***************************************************************************/
+
+void update_current( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//snapshot of the running sums
+	uint16_t sum[DC_MOTOR_NUM];
+	uint8_t num[DC_MOTOR_NUM];
+	//average of the tick. ADC results. Q3
+	int32_t avg;
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Take the sums and restart them
+	sreg_tmp = SREG;
+	cli();
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		sum[t] = g_adc_sum[t];
+		num[t] = g_adc_num[t];
+		g_adc_sum[t] = 0;
+		g_adc_num[t] = 0;
+	}
+	SREG = sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		//if: no result this tick
+		if (num[t] == 0)
+		{
+			continue;
+		}
+		avg = ((uint32_t)sum[t] << 3) /num[t];
+		current_filter[t] += (avg -(int32_t)current_filter[t]) >> CURRENT_FILTER_SHIFT;
+		motor_current[t] = ((uint32_t)current_filter[t] *CURRENT_SENSE_SCALE) >> (8 +3);
+	}	//End For: scan motors
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: update_current
+
+/****************************************************************************
+**  Function
+**  current_trip_adc | uint16_t
+****************************************************************************/
+//! @param trip | trip current. mA. 0 = disabled
+//! @return uint16_t | trip threshold as ADC result. 0xffff = disabled
+//! @brief Convert a trip current to the threshold compared by the ADC ISR
+/***************************************************************************/
+
+uint16_t current_trip_adc( uint16_t trip )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//threshold
+	uint32_t adc;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: trip disabled
+	if (trip == 0)
+	{
+		return (uint16_t)0xffff;
+	}
+	adc = ((uint32_t)trip << 8) /CURRENT_SENSE_SCALE;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return (adc > (uint16_t)0xffff)?((uint16_t)0xffff):((uint16_t)adc);
+}	//End: current_trip_adc
+
+/****************************************************************************
+**  Function
+**  current_limit_step | uint8_t, int32_t
+****************************************************************************/
+//! @param index	| motor
+//! @param value	| output of the ramp generator. PWM Q8
+//! @return int32_t | PWM allowed by the current limit. PWM Q8
+//! @brief Current limit stage between the ramp generator and the driver
+//! @details Called by update_pwm every system tick.
+//!	A motor tripped by the ADC ISR is held off and its ramp generator is reset
+/***************************************************************************/
+
+int32_t current_limit_step( uint8_t index, int32_t value )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//current above the limit. mA
+	uint16_t excess;
+	//reduction of the scale. Q8
+	uint16_t step;
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//if: the fast trip path cut the motor
+	if (IS_BIT_ONE( g_adc_trip_mask, index ))
+	{
+		sreg_tmp = SREG;
+		cli();
+		CLEAR_BIT( g_adc_trip_mask, index );
+		SREG = sreg_tmp;
+		current_limit.hold[index] = CURRENT_TRIP_HOLD;
+		//Restart from zero once the hold expires
+		current_limit.scale[index] = 0;
+	}
+	//if: the motor is held off after a trip
+	if (current_limit.hold[index] > 0)
+	{
+		current_limit.hold[index]--;
+		trajectory.value[index] = 0;
+		trajectory.rate[index] = 0;
+		return 0;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: the current is above the limit
+	if ((current_limit.limit[index] != 0) && (motor_current[index] > current_limit.limit[index]))
+	{
+		//Shrink the scale in proportion to the excess
+		excess = motor_current[index] -current_limit.limit[index];
+		step = ((uint32_t)excess *CURRENT_LIMIT_GAIN) >> 8;
+		current_limit.scale[index] = (step >= current_limit.scale[index])?(0):(current_limit.scale[index] -step);
+	}
+	//if: the scale is recovering
+	else if (current_limit.scale[index] < CURRENT_SCALE_FULL)
+	{
+		current_limit.scale[index] += CURRENT_LIMIT_RECOVERY;
+		current_limit.scale[index] = AT_SAT( current_limit.scale[index], CURRENT_SCALE_FULL, 0 );
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return (value *current_limit.scale[index]) >> 8;
+}	//End: current_limit_step
+
+/***************************************************************************/
+//!	@brief current limit configuration handler
+//!	current_limit_handler | uint16_t, uint16_t, uint16_t
+/***************************************************************************/
+//! @param index	| motor. Out of range = all the motors
+//! @param limit	| continuous current limit. mA. 0 = disabled
+//! @param trip		| trip current of the fast path. mA. 0 = disabled
+//! @return void
+//!	@details
+//! Handler for the current limit configuration command
+/***************************************************************************/
+
+void current_limit_handler( uint16_t index, uint16_t limit, uint16_t trip )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//trip threshold as ADC result
+	uint16_t trip_adc = current_trip_adc( trip );
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		//if: not the selected motor
+		if ((index < DC_MOTOR_NUM) && (index != t))
+		{
+			continue;
+		}
+		current_limit.limit[t] = limit;
+		current_limit.trip[t] = trip;
+		//The ADC ISR reads the threshold
+		sreg_tmp = SREG;
+		cli();
+		g_adc_trip[t] = trip_adc;
+		SREG = sreg_tmp;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: current_limit_handler | uint16_t, uint16_t, uint16_t
+
+/****************************************************************************
+**  Function
+**  current_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param arg		| unused
+//! @param payload	| output. TELEMETRY_CURRENT_LEN bytes
+//! @return uint8_t | payload length
+//! @brief Build the payload of the motor current frame
+//! @details
+//! | CURRENT0 L | CURRENT0 H | ... | CURRENT3 H | FLAGS |
+//! FLAGS: bit 0..3 motor 0..3 held off by a trip | bit 4..7 motor 0..3 limited
+/***************************************************************************/
+
+uint8_t current_reply( uint8_t arg, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//payload index
+	uint8_t i;
+	//flags byte
+	uint8_t flags;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	(void)arg;
+	i = 0;
+	flags = 0;
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		payload[i++] = U16L( motor_current[t] );
+		payload[i++] = U16H( motor_current[t] );
+		SET_BIT_VALUE( flags, t, (current_limit.hold[t] != 0) );
+		SET_BIT_VALUE( flags, t +4, (current_limit.scale[t] < CURRENT_SCALE_FULL) );
+	}
+	payload[i++] = flags;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return i;
+}	//End: current_reply
+
+/***************************************************************************/
+//!	@brief motor current query handler
+//!	current_handler | void
+/***************************************************************************/
+//! @return void
+//!	@details
+//! Handler for the motor current query. Answers with the current frame, see current_reply
+/***************************************************************************/
+
+void current_handler( void )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Answer on the port that asked, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_CURRENT, 0 );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: current_handler | void
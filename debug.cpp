@@ -19,7 +19,19 @@
 /****************************************************************************
 **	DESCRIPTION
 *****************************************************************************
+**	Global variables of the debug.h macros and, with ENABLE_DEBUG_ASYNC,
+**	the asynchronous host backend.
 **
+**		ASYNCHRONOUS BACKEND
+**	Each thread that prints owns a ring of DEBUG_ASYNC_BUF_SIZE bytes.
+**	The thread is the only writer of the head, the writer thread is the
+**	only writer of the tail, so the rings need no lock.
+**	A print formats tabs and string on the stack and copies them in the
+**	ring. The writer thread moves whole lines from the rings to the file,
+**	so the lines of different threads don't mix. A thread whose ring is
+**	full waits for the writer, nothing is lost.
+**	Rings are registered once per thread on a lock free list and freed
+**	by DSTOP. DSTART and DSTOP must not race with the threads that print
 ****************************************************************************/
 
 /****************************************************************************
@@ -37,6 +49,38 @@
 
 #ifdef ENABLE_DEBUG
 	#include <cstdio>
+	#ifdef ENABLE_DEBUG_ASYNC
+		#include <cstdarg>
+		#include <cstdlib>
+		#include <cstring>
+		#include <atomic>
+		#include <chrono>
+		#include <thread>
+	#endif
+#endif
+
+/****************************************************************************
+**	TYPEDEF
+****************************************************************************/
+
+#if defined( ENABLE_DEBUG ) && defined( ENABLE_DEBUG_ASYNC )
+
+//Ring of a thread that prints
+typedef struct _Debug_buf Debug_buf;
+
+/****************************************************************************
+**	STRUCTURE
+****************************************************************************/
+
+//Ring of a thread that prints. head and tail are free running byte counts
+struct _Debug_buf
+{
+	char *data;						//DEBUG_ASYNC_BUF_SIZE bytes
+	std::atomic<size_t> head;		//Bytes written by the thread
+	std::atomic<size_t> tail;		//Bytes moved to the file by the writer thread
+	Debug_buf *next;				//Next ring on the list
+};
+
 #endif
 
 /****************************************************************************
@@ -45,7 +89,370 @@
 
 DEBUG_VARS();
 
+#if defined( ENABLE_DEBUG ) && defined( ENABLE_DEBUG_ASYNC )
+
+//Rings of the threads that printed since DSTART
+std::atomic<Debug_buf *> g_debug_buf_list( nullptr );
+//Incremented by DSTART. A thread whose ring is from an older session registers a new one
+std::atomic<unsigned> g_debug_session( 0 );
+//The writer thread runs
+std::atomic<bool> g_debug_f_run( false );
+//Writer thread
+std::thread g_debug_writer;
+//Ring of the calling thread
+thread_local Debug_buf *g_debug_buf = nullptr;
+//Session of the ring of the calling thread
+thread_local unsigned g_debug_buf_session = 0;
+
+#endif
+
 /****************************************************************************
 **	FUNCTION
 ****************************************************************************/
 
+#if defined( ENABLE_DEBUG ) && defined( ENABLE_DEBUG_ASYNC )
+
+/****************************************************************************
+**  Function
+**  debug_buf_drain | Debug_buf &, bool
+****************************************************************************/
+//! @param buf		| ring to be drained
+//! @param f_all	| false: move whole lines only | true: move everything
+//! @return size_t | bytes moved to the file
+//! @brief Move the bytes of a ring to the debug file. Writer thread only
+//! @details A partial line is moved anyway if it fills the ring
+/***************************************************************************/
+
+static size_t debug_buf_drain( Debug_buf &buf, bool f_all )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	size_t head = buf.head.load( std::memory_order_acquire );
+	size_t tail = buf.tail.load( std::memory_order_relaxed );
+	//end of the bytes to be moved
+	size_t end = head;
+	//position in the ring
+	size_t pos;
+	//bytes before the end of the ring
+	size_t len;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: only whole lines are moved and the ring has room for the rest of the line
+	if ((f_all == false) && (head -tail < DEBUG_ASYNC_BUF_SIZE))
+	{
+		//Search the last end of line
+		while ((end != tail) && (buf.data[ (end -1) & (DEBUG_ASYNC_BUF_SIZE -1) ] != '\n'))
+		{
+			end--;
+		}
+	}
+	if (end == tail)
+	{
+		return 0;
+	}
+	pos = tail & (DEBUG_ASYNC_BUF_SIZE -1);
+	len = DEBUG_ASYNC_BUF_SIZE -pos;
+	//if: the bytes wrap around the end of the ring
+	if (end -tail > len)
+	{
+		fwrite( &buf.data[pos], 1, len, _debug_file );
+		fwrite( &buf.data[0], 1, end -tail -len, _debug_file );
+	}
+	else
+	{
+		fwrite( &buf.data[pos], 1, end -tail, _debug_file );
+	}
+	buf.tail.store( end, std::memory_order_release );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return end -tail;
+}	//End: debug_buf_drain
+
+/****************************************************************************
+**  Function
+**  debug_writer_task
+****************************************************************************/
+//! @return void |
+//! @brief Writer thread. Move the lines of the rings to the debug file until DSTOP
+/***************************************************************************/
+
+static void debug_writer_task( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//bytes moved in a pass
+	size_t num;
+	//ring
+	Debug_buf *buf;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	while (g_debug_f_run.load( std::memory_order_acquire ) == true)
+	{
+		num = 0;
+		for (buf = g_debug_buf_list.load( std::memory_order_acquire );buf != nullptr;buf = buf -> next)
+		{
+			num += debug_buf_drain( *buf, false );
+		}
+		//if: all the rings are empty
+		if (num == 0)
+		{
+			std::this_thread::sleep_for( std::chrono::microseconds( DEBUG_ASYNC_IDLE_US ) );
+		}
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: debug_writer_task
+
+/****************************************************************************
+**  Function
+**  debug_buf_push | const char *, size_t
+****************************************************************************/
+//! @param str	| bytes to be written
+//! @param len	| number of bytes. Clipped to the size of the ring
+//! @return void |
+//! @brief Copy bytes in the ring of the calling thread. Registers the ring on the first call of a session
+//! @details Waits for the writer thread while the ring is full
+/***************************************************************************/
+
+static void debug_buf_push( const char *str, size_t len )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	Debug_buf *buf = g_debug_buf;
+	unsigned session = g_debug_session.load( std::memory_order_acquire );
+	size_t head;
+	//position in the ring
+	size_t pos;
+	//bytes before the end of the ring
+	size_t room;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//if: the thread has no ring in this session. The old one has been freed by DSTOP
+	if ((buf == nullptr) || (g_debug_buf_session != session))
+	{
+		buf = new Debug_buf;
+		buf -> data = (char *)malloc( DEBUG_ASYNC_BUF_SIZE );
+		buf -> head.store( 0, std::memory_order_relaxed );
+		buf -> tail.store( 0, std::memory_order_relaxed );
+		buf -> next = g_debug_buf_list.load( std::memory_order_relaxed );
+		//Push on the list. Only the threads that print for the first time contend
+		while (g_debug_buf_list.compare_exchange_weak( buf -> next, buf, std::memory_order_release, std::memory_order_relaxed ) == false)
+		{
+		}
+		g_debug_buf = buf;
+		g_debug_buf_session = session;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	len = (len > DEBUG_ASYNC_BUF_SIZE)?(DEBUG_ASYNC_BUF_SIZE):(len);
+	head = buf -> head.load( std::memory_order_relaxed );
+	//while: the ring is full. The writer thread frees it
+	while (DEBUG_ASYNC_BUF_SIZE -(head -buf -> tail.load( std::memory_order_acquire )) < len)
+	{
+		std::this_thread::yield();
+	}
+	pos = head & (DEBUG_ASYNC_BUF_SIZE -1);
+	room = DEBUG_ASYNC_BUF_SIZE -pos;
+	//if: the bytes wrap around the end of the ring
+	if (len > room)
+	{
+		memcpy( &buf -> data[pos], str, room );
+		memcpy( &buf -> data[0], &str[room], len -room );
+	}
+	else
+	{
+		memcpy( &buf -> data[pos], str, len );
+	}
+	buf -> head.store( head +len, std::memory_order_release );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: debug_buf_push
+
+/****************************************************************************
+**  Function
+**  debug_async_start | const char *
+****************************************************************************/
+//! @param name	| name of the debug file
+//! @return FILE * | debug file. NULL if it can't be opened
+//! @brief Open the debug file and start the writer thread
+//! @details If the writer thread is already running the name is ignored and its file is returned
+/***************************************************************************/
+
+FILE *debug_async_start( const char *name )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	FILE *file;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: already started. The writer thread keeps its file
+	if (g_debug_f_run.load() == true)
+	{
+		return _debug_file;
+	}
+	file = fopen( name, "w+" );
+	if (file == NULL)
+	{
+		return file;
+	}
+	//The writer thread reads _debug_file
+	_debug_file = file;
+	g_debug_session++;
+	g_debug_f_run.store( true, std::memory_order_release );
+	g_debug_writer = std::thread( debug_writer_task );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return file;
+}	//End: debug_async_start
+
+/****************************************************************************
+**  Function
+**  debug_async_print | int, const char *, ...
+****************************************************************************/
+//! @param indent	| number of tabs before the string
+//! @param format	| printf format of the string
+//! @return int | number of bytes written
+//! @brief Format indent tabs and a string into the ring of the calling thread
+//! @details Strings longer than DEBUG_ASYNC_LINE_SIZE are formatted on the heap
+/***************************************************************************/
+
+int debug_async_print( int indent, const char *format, ... )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	char line[ DEBUG_ASYNC_LINE_SIZE ];
+	char *str = line;
+	va_list args;
+	int len;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	if (g_debug_f_run.load( std::memory_order_relaxed ) == false)
+	{
+		return 0;
+	}
+	indent = (indent < 0)?(0):((indent > DEBUG_ASYNC_LINE_SIZE /2)?(DEBUG_ASYNC_LINE_SIZE /2):(indent));
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	memset( line, '\t', indent );
+	va_start( args, format );
+	len = vsnprintf( &line[indent], DEBUG_ASYNC_LINE_SIZE -indent, format, args );
+	va_end( args );
+	if (len < 0)
+	{
+		return 0;
+	}
+	//if: the string doesn't fit the line
+	if (len >= DEBUG_ASYNC_LINE_SIZE -indent)
+	{
+		str = (char *)malloc( indent +len +1 );
+		memset( str, '\t', indent );
+		va_start( args, format );
+		vsnprintf( &str[indent], len +1, format, args );
+		va_end( args );
+	}
+	len += indent;
+	debug_buf_push( str, len );
+	if (str != line)
+	{
+		free( str );
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return len;
+}	//End: debug_async_print
+
+/****************************************************************************
+**  Function
+**  debug_async_stop
+****************************************************************************/
+//! @return void |
+//! @brief Stop the writer thread, write what is left in the rings, free them and close the debug file
+/***************************************************************************/
+
+void debug_async_stop( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	Debug_buf *buf;
+	Debug_buf *next;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	if (g_debug_f_run.load() == false)
+	{
+		return;
+	}
+	g_debug_f_run.store( false, std::memory_order_release );
+	g_debug_writer.join();
+	buf = g_debug_buf_list.exchange( nullptr );
+	while (buf != nullptr)
+	{
+		debug_buf_drain( *buf, true );
+		next = buf -> next;
+		free( buf -> data );
+		delete buf;
+		buf = next;
+	}
+	fflush( _debug_file );
+	fclose( _debug_file );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: debug_async_stop
+
+#endif
@@ -6,17 +6,52 @@
 	**********************************************************************************/
 
 	//#define ENABLE_DEBUG
+	//Host only. Format into per thread buffers, a writer thread writes them to the file. Comment out to write synchronously
+	#define ENABLE_DEBUG_ASYNC
 
 	/**********************************************************************************
 	**	GLOBAL INCLUDE
 	**********************************************************************************/
 
+	#ifdef ENABLE_DEBUG
+		#include <stdio.h>
+	#endif
+
+	//The asynchronous backend needs threads
+	#if defined( ENABLE_DEBUG_ASYNC ) && defined( __AVR__ )
+		#undef ENABLE_DEBUG_ASYNC
+	#endif
+
 	/**********************************************************************************
 	**	DEFINE
 	**********************************************************************************/
 
 	#define _DEBUG_MAX_INDENT_LEVEL	12
 
+	//	Compile time levels. A site is compiled only if its level is within the level of its module
+	//	A module is the scope of a DMODULE, or the translation unit outside of them
+
+	//No site
+	#define DEBUG_LEVEL_NONE		0
+	//DPRINT_ERR, DRETURN_ERR
+	#define DEBUG_LEVEL_ERROR		1
+	//DPRINT, DPRINT_NOTAB, DTAB
+	#define DEBUG_LEVEL_INFO		2
+	//DENTER, DRETURN, DENTER_ARG, DRETURN_ARG. Function trace and indentation
+	#define DEBUG_LEVEL_TRACE		3
+
+	//Level of the sites outside a DMODULE. Can be defined before the include
+	#ifndef DEBUG_LEVEL_DEFAULT
+		#define DEBUG_LEVEL_DEFAULT	DEBUG_LEVEL_TRACE
+	#endif
+
+	//Size of the buffer of a thread. Power of two. A thread that fills it waits for the writer
+	#define DEBUG_ASYNC_BUF_SIZE	(1UL << 20)
+	//Formatted lines up to this length don't touch the heap
+	#define DEBUG_ASYNC_LINE_SIZE	256
+	//Writer thread sleep when all the buffers are empty. us
+	#define DEBUG_ASYNC_IDLE_US		1000
+
 	/**********************************************************************************
 	**	MACRO
 	**********************************************************************************/
@@ -27,24 +62,57 @@
 		///	GLOBAL VARIABLES
 		///----------------------------------------------------------------
 
+		//Each thread has its own indentation when the writes are asynchronous
+		#ifdef ENABLE_DEBUG_ASYNC
+			#define _DEBUG_TLS	thread_local
+		#else
+			#define _DEBUG_TLS
+		#endif
+
 		//Variable prototypes for debug
 		#define DEBUG_VARS_PROTOTYPES()	\
 			extern FILE *_debug_file;	\
-			extern int _debug_indent_level, _debug_show_level
+			extern _DEBUG_TLS int _debug_indent_level;	\
+			extern int _debug_show_level
 
 		//Global variables for debug
 		#define DEBUG_VARS()	\
 			FILE  *_debug_file = NULL;	\
-			int _debug_indent_level = 0, _debug_show_level = 0
+			_DEBUG_TLS int _debug_indent_level = 0;	\
+			int _debug_show_level = 0
 
         //Change the show level
         #define DSHOW( level )  \
             _debug_show_level = (level)
 
+		///----------------------------------------------------------------
+		///	MODULE LEVEL MACROS
+		///----------------------------------------------------------------
+
+		//Set the compile time level of the sites until the end of the scope. First statement of a function
+		#define DMODULE( level )	\
+			constexpr int _debug_module_level = (level)
+
+		//Sites of a given level are compiled in the current module. Constant, disabled sites fold away
+		#define _DEBUG_ON( level )	\
+			((level) <= _debug_module_level)
+
 		///----------------------------------------------------------------
 		///	DEBUG FILE MACROS
 		///----------------------------------------------------------------
 
+		#ifdef ENABLE_DEBUG_ASYNC
+
+		//Open file, start the writer thread and start debugging. Call before the threads that print start
+		#define DSTART( user__debug_show_level )	\
+			_debug_file = debug_async_start( "debug.log" ), _debug_indent_level = 0, _debug_show_level = user__debug_show_level , debug_async_print( 0, "Start Debug!\n" )
+
+		//Stop debugging, write what is left in the buffers and close file. Call after the threads that print ended
+		#define DSTOP()	\
+			((_debug_file != NULL)?debug_async_print( 0, "\nDebug has Ended!\n" ), debug_async_stop(), _debug_file = NULL:(0))
+
+		#else
+
 		//Open file and start debugging
 		#define DSTART( user__debug_show_level )	\
 			_debug_file = fopen( "debug.log", "w+"), _debug_indent_level = 0, _debug_show_level = user__debug_show_level , fprintf(_debug_file, "Start Debug!\n")
@@ -53,21 +121,57 @@
 		#define DSTOP()	\
 			((_debug_file != NULL)?fprintf(_debug_file, "\nDebug has Ended!\n"), fflush(_debug_file), fclose(_debug_file), _debug_file = NULL:(0))
 
+		#endif
+
 		///----------------------------------------------------------------
 		///	DEBUG PRINT MACROS
 		///----------------------------------------------------------------
 
+		#ifdef ENABLE_DEBUG_ASYNC
+
+		//Print a number of tab equal to indent level than print user defined string. Any level
+		#define _DPRINT( ... )	\
+			(((_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(debug_async_print( _debug_indent_level, __VA_ARGS__ )):(0))
+
+		//print user defined string. Any level
+		#define _DPRINT_NOTAB( ... )	\
+			(((_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(debug_async_print( 0, __VA_ARGS__ )):(0))
+
+		//Print a given number of tab characters. Any level
+		#define _DTAB( n )	\
+			debug_async_print( (n), "%s", "" )
+
+		#else
+
+		//Print a number of tab equal to indent level than print user defined string. Any level
+		#define _DPRINT( ... )	\
+			(((_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(fprintf(_debug_file,"%.*s", _debug_indent_level, "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"), fprintf(_debug_file, __VA_ARGS__ )):(0))
+
+		//print user defined string. Any level
+		#define _DPRINT_NOTAB( ... )	\
+			(((_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(fprintf(_debug_file, __VA_ARGS__ )):(0))
+
+		//Print a given number of tab characters. Any level
+		#define _DTAB( n )	\
+			fprintf(_debug_file,"%.*s", n, "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t")
+
+		#endif
+
 		//Print a given number of tab characters
 		#define DTAB(n)	\
-			(((_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(fprintf(_debug_file,"%.*s", n, "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t")):(0));
+			((_DEBUG_ON( DEBUG_LEVEL_INFO ) && (_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(_DTAB( n )):(0));
 
 		//Print a number of tab equal to indent level than print user defined string
 		#define DPRINT( ... )	\
-			(((_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(fprintf(_debug_file,"%.*s", _debug_indent_level, "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"), fprintf(_debug_file, __VA_ARGS__ )):(0))
+			((_DEBUG_ON( DEBUG_LEVEL_INFO ))?(_DPRINT( __VA_ARGS__ )):(0))
 
 		//print user defined string
 		#define DPRINT_NOTAB( ... )	\
-			(((_debug_file != NULL) && (_debug_indent_level >= _debug_show_level))?(fprintf(_debug_file, __VA_ARGS__ )):(0))
+			((_DEBUG_ON( DEBUG_LEVEL_INFO ))?(_DPRINT_NOTAB( __VA_ARGS__ )):(0))
+
+		//Print an error
+		#define DPRINT_ERR( ... )	\
+			((_DEBUG_ON( DEBUG_LEVEL_ERROR ))?(_DPRINT( __VA_ARGS__ )):(0))
 
 		///----------------------------------------------------------------
 		///	FUNCTION TRACE MACROS
@@ -75,19 +179,23 @@
 
 		//Enter Function and increase indent level. No argument print version
 		#define DENTER()	\
-			DPRINT( "-->> \"%s\" |\n", __FUNCTION__), (_debug_indent_level<_DEBUG_MAX_INDENT_LEVEL)?(++_debug_indent_level):(_DEBUG_MAX_INDENT_LEVEL)
+			((_DEBUG_ON( DEBUG_LEVEL_TRACE ))?(_DPRINT( "-->> \"%s\" |\n", __FUNCTION__), (_debug_indent_level<_DEBUG_MAX_INDENT_LEVEL)?(++_debug_indent_level):(_DEBUG_MAX_INDENT_LEVEL)):(0))
 
 		//Return from function and decrease indent level. No argument version
 		#define DRETURN()	\
-			(_debug_indent_level>0)?(--_debug_indent_level):(0), DPRINT( "<<-- \"%s\" |\n", __FUNCTION__)
+			((_DEBUG_ON( DEBUG_LEVEL_TRACE ))?((_debug_indent_level>0)?(--_debug_indent_level):(0), _DPRINT( "<<-- \"%s\" |\n", __FUNCTION__)):(0))
 
 		//Enter Function and increase indent level. No argument print version
 		#define DENTER_ARG( ... )	\
-			DPRINT( "-->> \"%s\" | ", __FUNCTION__), DPRINT_NOTAB( __VA_ARGS__ ), (_debug_indent_level<_DEBUG_MAX_INDENT_LEVEL)?(++_debug_indent_level):(_DEBUG_MAX_INDENT_LEVEL)
+			((_DEBUG_ON( DEBUG_LEVEL_TRACE ))?(_DPRINT( "-->> \"%s\" | ", __FUNCTION__), _DPRINT_NOTAB( __VA_ARGS__ ), (_debug_indent_level<_DEBUG_MAX_INDENT_LEVEL)?(++_debug_indent_level):(_DEBUG_MAX_INDENT_LEVEL)):(0))
 
 		//Return from function and decrease indent level. No argument version
 		#define DRETURN_ARG( ... )	\
-			(_debug_indent_level>0)?(--_debug_indent_level):(0), DPRINT( "<<-- \"%s\" | ", __FUNCTION__), DPRINT_NOTAB( __VA_ARGS__ )
+			((_DEBUG_ON( DEBUG_LEVEL_TRACE ))?((_debug_indent_level>0)?(--_debug_indent_level):(0), _DPRINT( "<<-- \"%s\" | ", __FUNCTION__), _DPRINT_NOTAB( __VA_ARGS__ )):(0))
+
+		//Return from function with an error. The indent level follows DENTER, the print is an error
+		#define DRETURN_ERR( ... )	\
+			((_DEBUG_ON( DEBUG_LEVEL_TRACE ) && (_debug_indent_level>0))?(--_debug_indent_level):(0)), ((_DEBUG_ON( DEBUG_LEVEL_ERROR ))?(_DPRINT( "<<-- \"%s\" | ", __FUNCTION__), _DPRINT_NOTAB( __VA_ARGS__ )):(0))
 
 	#else
 		#define DEBUG_VARS_PROTOTYPES()
@@ -96,6 +204,8 @@
 
 		#define DSHOW( ... )
 
+		#define DMODULE( ... )
+
 		#define DSTART( ... )
 
 		#define DSTOP()
@@ -106,6 +216,8 @@
 
 		#define DPRINT_NOTAB( ... )
 
+		#define DPRINT_ERR( ... )
+
 		#define DENTER( ... )
 
 		#define DRETURN( ... )
@@ -113,6 +225,8 @@
 		#define DENTER_ARG( ... )
 
 		#define DRETURN_ARG( ... )
+
+		#define DRETURN_ERR( ... )
 	#endif
 
 	/**********************************************************************************
@@ -130,10 +244,24 @@
 	//Global variables prototype
 	DEBUG_VARS_PROTOTYPES();
 
+	#ifdef ENABLE_DEBUG
+	//Level of the sites outside a DMODULE. One per translation unit
+	static constexpr int _debug_module_level = DEBUG_LEVEL_DEFAULT;
+	#endif
+
 	/**********************************************************************************
 	**	PROTOTYPE: FUNCTION
 	**********************************************************************************/
 
+	#if defined( ENABLE_DEBUG ) && defined( ENABLE_DEBUG_ASYNC )
+	//Open the debug file and start the writer thread
+	extern FILE *debug_async_start( const char *name );
+	//Format indent tabs and a string into the buffer of the calling thread
+	extern int debug_async_print( int indent, const char *format, ... ) __attribute__ (( format (printf, 2, 3) ));
+	//Stop the writer thread, write what is left in the buffers and close the debug file
+	extern void debug_async_stop( void );
+	#endif
+
 #else
 	#warning "multiple inclusion of the header file"
 #endif
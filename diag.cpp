@@ -0,0 +1,273 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	DRIVER DIAGNOSTIC
+*****************************************************************
+**	Periodic diagnostic of the VNH7040 through the MultiSense mux.
+**	SEL1 (PF1) is shared by the four drivers, SEL0 is INA.
+**	SEL1 = 0			: current of the active high side. See current.cpp
+**	SEL1 = 1, SEL0 = 0	: chip temperature TCHIP
+**	SEL1 = 1, SEL0 = 1	: supply voltage VCC /DIAG_VCC_DIV
+**	SEL0 can't be moved without moving the motor, so each window
+**	reads TCHIP of the drivers with f_dir = false and VCC of the
+**	drivers with f_dir = true. A driver in fault drives its
+**	MultiSense to VSENSEH, which saturates the ADC.
+**
+**		DIAGNOSTIC WINDOW
+**	diag_task runs right after update_pwm. If the scheduler has
+**	DIAG_WINDOW_RTC counts of slack before the next tick, it
+**	raises SEL1 and hands the ADC ISR to diag_isr:
+**	- DIAG_SETTLE_NUM results are discarded while the mux settles
+**	- One result per channel is captured
+**	- SEL1 is lowered by the ISR itself
+**	- DIAG_SETTLE_NUM results are discarded, then the ISR goes
+**	  back to the current sense
+**	SEL1 stays high for DIAG_SETTLE_NUM +DC_MOTOR_NUM results,
+**	about 600us. The whole window is over before the next tick,
+**	so update_pwm and update_current never see it.
+**	The current sum and the fast trip path are paused in the window.
+**	If there's no slack, the window is skipped and counted.
+**	The next run of diag_task turns the captured results into the
+**	fault flags of the drivers
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Status of the diagnostic window. Shared with the ADC ISR
+volatile uint8_t g_diag_state;
+//ADC results still to be discarded while the MultiSense settles
+volatile uint8_t g_diag_cnt;
+//ADC results captured in the window
+volatile uint8_t g_diag_num;
+//ADC results captured in the window. One per channel
+volatile uint16_t g_diag_res[DC_MOTOR_NUM];
+
+//Fault flags and readings of the drivers
+Diag diag;
+
+/****************************************************************************
+**  Function
+**  init_diag
+****************************************************************************/
+//! @return void |
+//! @brief Initialize the diagnostic of the drivers
+//! @details No window is open, no fault is known
+/***************************************************************************/
+
+void init_diag( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	g_diag_state = DIAG_OFF;
+	g_diag_cnt = 0;
+	g_diag_num = 0;
+	//For: scan drivers
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		g_diag_res[t] = 0;
+		diag.fault[t] = 0;
+		diag.f_vcc[t] = false;
+		diag.tchip[t] = 0;
+		diag.vcc[t] = 0;
+	}
+	diag.window_cnt = 0;
+	diag.skip_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_diag
+
+/****************************************************************************
+**  Function
+**  diag_task
+****************************************************************************/
+//! @return void |
+//! @brief Decode the last diagnostic window and open a new one
+//! @details Called by the scheduler every DIAG_PERIOD system ticks, right after update_pwm.
+//!	Opens a window only if it can end before the next system tick
+/***************************************************************************/
+
+void diag_task( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//captured result
+	uint16_t res;
+	//captured result. mV on the MultiSense
+	uint16_t mv;
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//if: a window is still open. It should have closed within the last tick
+	if ((g_diag_state != DIAG_OFF) && (g_diag_state != DIAG_DONE))
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+		///Decode the last window
+	//if: a window completed
+	if (g_diag_state == DIAG_DONE)
+	{
+		//For: scan drivers
+		for (t = 0;t < DC_MOTOR_NUM;t++)
+		{
+			res = g_diag_res[t];
+			mv = ((uint32_t)res *ADC_VREF_MV) /((uint16_t)1024 *ADC_ACC_NUM);
+			//if: SEL0 was high
+			if (diag.f_vcc[t] == true)
+			{
+				diag.vcc[t] = mv *DIAG_VCC_DIV;
+				SET_BIT_VALUE( diag.fault[t], DIAG_FAULT_UNDERVOLTAGE, (diag.vcc[t] < DIAG_VCC_MIN_MV) );
+			}
+			else
+			{
+				diag.tchip[t] = mv;
+				//TCHIP falls as the temperature rises
+				SET_BIT_VALUE( diag.fault[t], DIAG_FAULT_HOT, (diag.tchip[t] < DIAG_TCHIP_HOT_MV) );
+			}
+			//A driver in fault saturates the MultiSense, whatever the mux
+			SET_BIT_VALUE( diag.fault[t], DIAG_FAULT_SENSEH, ((res >= DIAG_SENSEH_RES) || ((current_filter[t] >> 3) >= DIAG_SENSEH_RES)) );
+		}
+		diag.window_cnt++;
+		g_diag_state = DIAG_OFF;
+	}
+
+		///Open a new window
+	//if: the window wouldn't end before the next tick
+	if (scheduler_slack() < DIAG_WINDOW_RTC)
+	{
+		diag.skip_cnt++;
+		return;
+	}
+	//For: scan drivers
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		//SEL0 is INA, low while braking. update_pwm won't move it before the window ends
+		diag.f_vcc[t] = ((dc_motor.f_dir[t] != false) && (dc_motor.f_brake[t] == false));
+	}
+	sreg_tmp = SREG;
+	cli();
+	g_diag_num = 0;
+	g_diag_cnt = DIAG_SETTLE_NUM;
+	g_diag_state = DIAG_SAMPLE;
+	PORTF.OUTSET = DIAG_SEL1_bm;
+	SREG = sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: diag_task
+
+/****************************************************************************
+**  Function
+**  diag_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param arg		| unused
+//! @param payload	| output. TELEMETRY_DIAG_LEN bytes
+//! @return uint8_t | payload length
+//! @brief Build the payload of the driver diagnostic frame
+//! @details
+//! | FAULT | TCHIP L | TCHIP H | VCC L | VCC H | for each driver, then | WINDOWS | SKIPPED |
+/***************************************************************************/
+
+uint8_t diag_reply( uint8_t arg, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//payload index
+	uint8_t i;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	(void)arg;
+	i = 0;
+	//For: scan drivers
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		payload[i++] = diag.fault[t];
+		payload[i++] = U16L( diag.tchip[t] );
+		payload[i++] = U16H( diag.tchip[t] );
+		payload[i++] = U16L( diag.vcc[t] );
+		payload[i++] = U16H( diag.vcc[t] );
+	}
+	payload[i++] = diag.window_cnt;
+	payload[i++] = diag.skip_cnt;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return i;
+}	//End: diag_reply
+
+/***************************************************************************/
+//!	@brief driver diagnostic query handler
+//!	diag_handler | void
+/***************************************************************************/
+//! @return void
+//!	@details
+//! Handler for the driver diagnostic query. Answers with the diagnostic frame, see diag_reply
+/***************************************************************************/
+
+void diag_handler( void )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Answer on the port that asked, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_DIAG, 0 );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: diag_handler | void
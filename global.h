@@ -19,16 +19,27 @@
 
 	//type definition using the bit width and signedness
 	#include <stdint.h>
-	//define the ISR routune, ISR vector, and the sei() cli() function
-	#include <avr/interrupt.h>
-	//name all the register and bit
-	#include <avr/io.h>
-	//hard delay
-	#include <util/delay.h>
+	#ifdef __AVR__
+		//define the ISR routune, ISR vector, and the sei() cli() function
+		#include <avr/interrupt.h>
+		//name all the register and bit
+		#include <avr/io.h>
+		//hard delay
+		#include <util/delay.h>
+	#else
+		//Host build. Simulated registers and peripherals, ISR callable as functions
+		#include "host_hal.h"
+	#endif
 	//General purpose macros
 	#include "at_utils.h"
 	//AT4809 PORT macros definitions
 	#include "at4809_port.h"
+	//Universal Parser V4. Each USART port owns one
+	#include "uniparser.h"
+	//Section profiler. Compiled out unless ENABLE_PROFILE is defined
+	#include "profile.h"
+	//Binary event trace. Compiled out unless ENABLE_TRACE is defined
+	#include "trace.h"
 
 	/****************************************************************************
 	**	DEFINE
@@ -38,14 +49,40 @@
 		///	BUFFERS
 		///----------------------------------------------------------------------
 
-	#define RPI_RX_BUF_SIZE		16
-	#define RPI_TX_BUF_SIZE		8
+	//Must hold a few pipelined commands
+	#define RPI_RX_BUF_SIZE		32
+	//Must hold at least one full telemetry frame
+	#define RPI_TX_BUF_SIZE		32
+
+		///----------------------------------------------------------------------
+		///	USART PORTS
+		///----------------------------------------------------------------------
+		//	To attach a new board: add an index, allocate its vectors, call init_uart_port
+		//	and route the USARTn_RXC_vect to uart_port_rx_isr in int.cpp
+
+	//Number of USART ports in use
+	#define UART_PORT_NUM		1
+	//Index of the RPI port inside g_uart_port
+	#define UART_PORT_RPI		0
 	
 		///----------------------------------------------------------------------
 		///	PARSER
 		///----------------------------------------------------------------------
 			
+	//Tiers of the communication timeout. Silence in timeout_task periods, about 10ms
+	//Silence before the link is reported late. The last setpoint is held
+	#define COM_TIMEOUT_HOLD	5
+	//Silence before the motors ramp down along the ramp limits
+	#define COM_TIMEOUT_DECEL	20
+	//Silence before the motors are cut
 	#define RPI_COM_TIMEOUT		50
+	//Tier of the communication timeout
+	#define COM_TIER_OK			0	//Commands are flowing
+	#define COM_TIER_HOLD		1	//Link is late. Last setpoint is held
+	#define COM_TIER_DECEL		2	//Motors ramp down to zero, velocity loops are open
+	#define COM_TIER_STOP		3	//Motors are cut. f_timeout_detected
+	//Length of the board signature, without the terminator
+	#define BOARD_SIGN_LEN		22
 	
 		///----------------------------------------------------------------------
 		///	MOTORS
@@ -53,10 +90,296 @@
 	
 	//Number of DC motors mounted on the platform
 	#define DC_MOTOR_NUM		4
-	//Maximum slew rate. PWM increment per tick
+	//Default ramp limit. PWM increment per tick
 	#define DC_MOTOR_SLEW_RATE	1
 	//Maximum PWM setting
 	#define DC_MOTOR_MAX_PWM	50
+	//Maximum duty setting. Duties are Q8 of the 8bit PWM
+	#define DC_MOTOR_MAX_DUTY	((uint16_t)DC_MOTOR_MAX_PWM << 8)
+	//Maximum ramp limits. Full PWM range in one tick. Q8
+	#define TRAJ_LIMIT_MAX		DC_MOTOR_MAX_DUTY
+	//Dither the fraction of the duty over the PWM periods in the TCB0 ISR. Comment out to truncate the duty to 8bit
+	#define ENABLE_PWM_DITHER
+	//Host builds only. Check update_pwm against the implementation it replaced, see pwm_check.cpp
+	//#define ENABLE_PWM_CHECK
+	#ifdef __AVR__
+		#undef ENABLE_PWM_CHECK
+	#endif
+	//Stop modes. What a motor does when its target is zero
+	#define MOTOR_STOP_RAMP		0	//Ramp down through the ramp generator
+	#define MOTOR_STOP_COAST	1	//Drop the PWM at once and let the motor freewheel
+	#define MOTOR_STOP_BRAKE	2	//Drop the PWM at once and hold the active brake
+	//Reversal modes. What a motor does when its target changes direction
+	#define MOTOR_REVERSE_RAMP	0	//Ramp down and up through the ramp generator
+	#define MOTOR_REVERSE_BRAKE	1	//Active brake until the wheel stops, then ramp up from zero
+	//Maximum length of the active brake of a reversal in system ticks
+	#define MOTOR_BRAKE_MAX_TICKS	128
+	//Minimum length of the active brake of a reversal. The speed has been measured at least once
+	#define MOTOR_BRAKE_MIN_TICKS	SPEED_CTRL_PERIOD
+	//Wheel speed below which the reversal brake ends in mm/s
+	#define MOTOR_BRAKE_STOP_SPEED	20
+
+		///----------------------------------------------------------------------
+		///	PWM CARRIER
+		///----------------------------------------------------------------------
+		//	CLK_TCA clocks the timers type B, which run in 8bit PWM mode.
+		//	The solver picks the smallest TCA prescaler whose period fits 8bit,
+		//	which gives the finest resolution for the requested carrier.
+		//	Higher carrier: quieter motors, more switching losses, fewer counts.
+		//	Duties stay Q8 of a 256 count period whatever the carrier, see pwm_duty_cnt
+
+	//Requested PWM carrier frequency. Hz
+	#define PWM_CARRIER_HZ		19531
+	//Minimum number of counts in a PWM period
+	#define PWM_RESOLUTION_MIN	64
+
+	//N of the TCA prescalers DIV1 to DIV1024. fout = fin /2^N
+	constexpr uint8_t pwm_tca_shift[] = { 0, 1, 2, 3, 4, 6, 8, 10 };
+	//TCA clock selection of each prescaler
+	constexpr uint8_t pwm_tca_clksel[] =
+	{
+		TCA_SINGLE_CLKSEL_DIV1_gc, TCA_SINGLE_CLKSEL_DIV2_gc, TCA_SINGLE_CLKSEL_DIV4_gc, TCA_SINGLE_CLKSEL_DIV8_gc,
+		TCA_SINGLE_CLKSEL_DIV16_gc, TCA_SINGLE_CLKSEL_DIV64_gc, TCA_SINGLE_CLKSEL_DIV256_gc, TCA_SINGLE_CLKSEL_DIV1024_gc
+	};
+	//Number of TCA prescalers
+	constexpr uint8_t PWM_TCA_NUM = sizeof( pwm_tca_shift );
+	//Prescaler chosen by the solver
+	constexpr uint8_t PWM_TCA_INDEX = at_prescaler_solve( F_CPU, PWM_CARRIER_HZ, pwm_tca_shift, PWM_TCA_NUM, 255 );
+	static_assert( PWM_TCA_INDEX < PWM_TCA_NUM, "PWM_CARRIER_HZ is too low for an 8bit period even with DIV1024" );
+	//N of the chosen prescaler
+	constexpr uint8_t PWM_TCA_SHIFT = pwm_tca_shift[ (PWM_TCA_INDEX < PWM_TCA_NUM)?(PWM_TCA_INDEX):(0) ];
+	//TOP of the timers type B. The period is PWM_TOP +1 counts
+	constexpr uint8_t PWM_TOP = AT_OCR_ROUND( F_CPU, PWM_CARRIER_HZ, PWM_TCA_SHIFT, 0 );
+	static_assert( (uint16_t)PWM_TOP +1 >= PWM_RESOLUTION_MIN, "PWM_CARRIER_HZ is too high for PWM_RESOLUTION_MIN" );
+	//Achieved CLK_TCA. Hz
+	constexpr uint32_t PWM_TCA_HZ = (uint32_t)F_CPU >> PWM_TCA_SHIFT;
+	//Achieved PWM carrier frequency. Hz
+	constexpr uint32_t PWM_CARRIER_HZ_ACTUAL = PWM_TCA_HZ /((uint16_t)PWM_TOP +1);
+	//The section profiler counts CLK_TCA
+	static_assert( PROFILE_NS_PER_CNT == (1000000000UL /PWM_TCA_HZ), "PROFILE_NS_PER_CNT must follow the TCA prescaler" );
+	//The trace timestamps count CLK_TCA too
+	static_assert( TRACE_NS_PER_CNT == (1000000000UL /PWM_TCA_HZ), "TRACE_NS_PER_CNT must follow the TCA prescaler" );
+
+	//Commit the settings of the drivers together, at a common PWM period boundary. Comment out to write them at once
+	#define ENABLE_PWM_SYNC
+	//Longest PWM period the main loop waits for a commit window. CPU cycles
+	#define PWM_SYNC_MAX_CYCLES		2048
+	//Length of the commit burst. Ports and timers of four drivers. CPU cycles
+	#define PWM_SYNC_BURST_CYCLES	160
+	//Length of the dither ISR from the read of the counter to the last write of a timer. CPU cycles
+	#define PWM_ISR_GUARD_CYCLES	96
+
+	//Length of a PWM period. CPU cycles
+	constexpr uint32_t PWM_PERIOD_CYCLES = ((uint32_t)PWM_TOP +1) << PWM_TCA_SHIFT;
+	//The main loop waits for a commit window only if the period is short enough
+	constexpr bool PWM_SYNC_WAIT = (PWM_PERIOD_CYCLES <= PWM_SYNC_MAX_CYCLES);
+	//Counts the commit burst needs before the end of the period
+	constexpr uint8_t PWM_SYNC_BURST_CNT = (PWM_SYNC_BURST_CYCLES >> PWM_TCA_SHIFT) +1;
+	//Counts the dither ISR may run past its read of the counter
+	constexpr uint8_t PWM_ISR_GUARD_CNT = (PWM_ISR_GUARD_CYCLES >> PWM_TCA_SHIFT) +1;
+
+		///----------------------------------------------------------------------
+		///	SPEED CONTROL
+		///----------------------------------------------------------------------
+		//	Geometry of the mounted encoders and wheels
+
+	//Encoder counts per wheel revolution. Four counts per encoder cycle
+	#define ENC_CNT_PER_REV		1440
+	//Wheel circumference in mm
+	#define WHEEL_CIRCUMFERENCE	204
+	//Period of the velocity loop in system ticks
+	#define SPEED_CTRL_PERIOD	10
+	//Frequency of the system tick in Hz. RTC 32768Hz /64
+	#define SYSTEM_TICK_HZ		512
+	//Encoder counts in a period to mm/s. Q8
+	#define ENC_SPEED_SCALE		((int32_t)256 *WHEEL_CIRCUMFERENCE *SYSTEM_TICK_HZ /((int32_t)ENC_CNT_PER_REV *SPEED_CTRL_PERIOD))
+	//Default gains of the velocity loop. Q8
+	#define SPEED_CTRL_KP		64
+	#define SPEED_CTRL_KI		16
+
+		///----------------------------------------------------------------------
+		///	KINEMATICS
+		///----------------------------------------------------------------------
+
+	//Default distance between the left and right wheels in mm
+	#define PLATFORM_TRACK_WIDTH	180
+	//Maximum track accepted by the configuration command in mm. Keeps the mixing inside 32bit
+	#define PLATFORM_TRACK_MAX		2000
+	//Default maximum speed of a side in mm/s. Mapped to DC_MOTOR_MAX_PWM by the open loop commands
+	#define PLATFORM_MAX_SPEED		500
+
+		///----------------------------------------------------------------------
+		///	CURRENT SENSE
+		///----------------------------------------------------------------------
+		//	VNH7040 MultiSense. Adjust K and the sense resistor to the board
+
+	//ADC reference in mV
+	#define ADC_VREF_MV				2500
+	//ADC conversions summed in hardware into a result
+	#define ADC_ACC_NUM				8
+	//Load current to sense current ratio of the VNH7040
+	#define CURRENT_SENSE_K			2890
+	//Sense resistor in Ohm
+	#define CURRENT_SENSE_RES		1000
+	//ADC result to mA. Q8
+	#define CURRENT_SENSE_SCALE		((uint32_t)256 *ADC_VREF_MV *CURRENT_SENSE_K /((uint32_t)1024 *ADC_ACC_NUM *CURRENT_SENSE_RES))
+	//Maximum ADC results in a running sum. Must fit 16bit
+	#define CURRENT_SUM_MAX_NUM		8
+	//g_adc_ch of the first result after boot, which is discarded
+	#define CURRENT_ADC_CH_BOOT		0xFF
+	//Low pass filter of the currents. Time constant is 2^SHIFT system ticks
+	#define CURRENT_FILTER_SHIFT	3
+	//Default continuous current limit of a motor in mA
+	#define CURRENT_LIMIT_MA		4000
+	//Default trip current of the fast path in mA. Must be inside the sense range
+	#define CURRENT_TRIP_MA			6500
+	//Full PWM scale of the current limit. Q8
+	#define CURRENT_SCALE_FULL		256
+	//Reduction of the PWM scale per mA above the limit per tick. Q8 of the scale
+	#define CURRENT_LIMIT_GAIN		4
+	//Recovery of the PWM scale per tick below the limit
+	#define CURRENT_LIMIT_RECOVERY	2
+	//System ticks a tripped motor stays off
+	#define CURRENT_TRIP_HOLD		255
+	//Time of an ADC result in us. 15 CLK_ADC per conversion, CLK_ADC = 20MHz /16
+	#define ADC_RESULT_US			(ADC_ACC_NUM *15 *16 /20)
+
+		///----------------------------------------------------------------------
+		///	DRIVER DIAGNOSTIC
+		///----------------------------------------------------------------------
+		//	VNH7040 MultiSense levels. Adjust to the datasheet and the board
+
+	//SEL1 pin of the drivers. PF1
+	#define DIAG_SEL1_bm			0x02
+	//Period of the diagnostic window in system ticks
+	#define DIAG_PERIOD				64
+	//ADC results discarded while the MultiSense settles after a mux change
+	#define DIAG_SETTLE_NUM			2
+	//Length of the diagnostic window in RTC counts. One more result for the conversion in flight
+	#define DIAG_WINDOW_RTC			((uint16_t)(((uint32_t)(2 *DIAG_SETTLE_NUM +DC_MOTOR_NUM +1) *ADC_RESULT_US *32768) /1000000) +1)
+	//MultiSense VCC output is VCC divided by
+	#define DIAG_VCC_DIV			4
+	//Minimum supply voltage in mV
+	#define DIAG_VCC_MIN_MV			6500
+	//TCHIP output below which the driver is hot in mV
+	#define DIAG_TCHIP_HOT_MV		1700
+	//ADC result of a MultiSense saturated by a driver in fault
+	#define DIAG_SENSEH_RES			8100
+	//Status of the diagnostic window
+	#define DIAG_OFF				0	//Current sense
+	#define DIAG_DONE				1	//Current sense. Results of the last window waiting for diag_task
+	#define DIAG_SAMPLE				2	//SEL1 high. Settle, then capture one result per channel
+	#define DIAG_RECOVER			3	//SEL1 low. Settle, then back to current sense
+	//Fault flags of a driver
+	#define DIAG_FAULT_SENSEH		0	//MultiSense saturated. Driver in fault or current out of range
+	#define DIAG_FAULT_HOT			1	//TCHIP above the limit
+	#define DIAG_FAULT_UNDERVOLTAGE	2	//VCC below the limit
+
+		///----------------------------------------------------------------------
+		///	TELEMETRY
+		///----------------------------------------------------------------------
+
+	//Start of frame marker. Outside the ASCII range so the Pi can tell binary frames apart from text replies
+	#define TELEMETRY_SYNC		0xA5
+	//Frame overhead. SYNC, TYPE, LEN, CHECKSUM
+	#define TELEMETRY_FRAME_OVERHEAD	4
+	//Frame type of the motor state frame
+	#define TELEMETRY_TYPE_MOTOR	'T'
+	//Payload of the motor state frame. SEQ, TICK(2), PWM(4), TARGET PWM(4), DIR, TIMEOUT CNT, FLAGS
+	#define TELEMETRY_MOTOR_LEN	14
+	//Bits of the flags byte of the motor state frame
+	#define TELEMETRY_FLAG_TIMEOUT		0
+	#define TELEMETRY_FLAG_THROTTLED	1
+	#define TELEMETRY_FLAG_HOLD			2
+	#define TELEMETRY_FLAG_DECEL		3
+	//Frame types of the replies to sequence numbered commands. Payload: ACK BASE, RX MASK
+	#define TELEMETRY_TYPE_ACK		'A'
+	#define TELEMETRY_TYPE_NAK		'N'
+	#define TELEMETRY_ACK_LEN		2
+	//Frame type of the task statistics frame. Answer to the task statistics query
+	#define TELEMETRY_TYPE_TASK		'K'
+	//Payload of the task statistics frame. INDEX, PERIOD, PHASE, PRIORITY, NUM EXE(2), EXE MIN(2), EXE MAX(2), LAT MIN(2), LAT MAX(2)
+	#define TELEMETRY_TASK_LEN		14
+	//Queries answered through the deferred replies. Bit of Reply_status::pending. Pending replies are sent in this order
+	#define REPLY_TASK				0
+	#define REPLY_TICK				1
+	#define REPLY_PROFILE			2
+	#define REPLY_CURRENT			3
+	#define REPLY_DIAG				4
+	#define REPLY_RESET				5
+	#define REPLY_SIGN				6
+	#define REPLY_TRACE				7
+	#define REPLY_NUM				8
+	static_assert( REPLY_NUM <= 8, "the pending replies are a uint8_t mask" );
+	//Arguments of a query are 0 to REPLY_ARG_NUM -1, each has its own reply
+	#define REPLY_ARG_NUM			16
+	static_assert( (PROFILE_NUM <= REPLY_ARG_NUM) && (TRACE_SIZE /TRACE_FRAME_REC <= REPLY_ARG_NUM), "the pending arguments are a uint16_t mask" );
+	//Type of a reply sent as plain text, without the frame. The board signature
+	#define TELEMETRY_TYPE_NONE		0
+	//Frame type of the system tick statistics frame. Answer to the tick statistics query
+	#define TELEMETRY_TYPE_TICK		'O'
+	//Payload of the system tick statistics frame. OVERRUN(2), LOST(2), BACKLOG MAX, LATENCY MAX(2), IDLE, IDLE MIN
+	#define TELEMETRY_TICK_LEN		9
+	//Frame type of the profile frame. Answer to the profiler dump command
+	#define TELEMETRY_TYPE_PROFILE	'P'
+	//Payload of the profile frame. ID, NUM(2), MIN(2), MAX(2), AVG(2)
+	#define TELEMETRY_PROFILE_LEN	9
+	//Frame type of the trace frame. Answer to the trace dump command
+	#define TELEMETRY_TYPE_TRACE	'X'
+	//Payload of the trace frame. HEAD, INDEX, then CODE, ARG, TIME(2) of each record in the chunk
+	#define TELEMETRY_TRACE_LEN		(2 +TRACE_FRAME_REC *TRACE_REC_LEN)
+	//The ring index is a free running uint8_t
+	static_assert( (TRACE_SIZE <= 256) && ((TRACE_SIZE & (TRACE_SIZE -1)) == 0) && ((TRACE_SIZE %TRACE_FRAME_REC) == 0), "TRACE_SIZE must be a power of two and a multiple of TRACE_FRAME_REC" );
+	//A circular buffer holds one less element than its size
+	static_assert( TELEMETRY_TRACE_LEN +TELEMETRY_FRAME_OVERHEAD < RPI_TX_BUF_SIZE, "a trace frame must fit the TX buffer" );
+	//Frame type of the motor current frame. Answer to the current query
+	#define TELEMETRY_TYPE_CURRENT	'C'
+	//Payload of the motor current frame. CURRENT0..3(2) in mA, FLAGS
+	#define TELEMETRY_CURRENT_LEN	9
+	//Frame type of the driver diagnostic frame. Answer to the diagnostic query
+	#define TELEMETRY_TYPE_DIAG		'D'
+	//Payload of the driver diagnostic frame. FAULT, TCHIP(2), VCC(2) of each driver in mV, WINDOWS, SKIPPED
+	#define TELEMETRY_DIAG_LEN		22
+
+		///----------------------------------------------------------------------
+		///	SCHEDULER
+		///----------------------------------------------------------------------
+
+	//RTC counts in a system tick. RTC PIT period
+	#define SCHED_RTC_CNT_PER_TICK	64
+	//Length of a count of the task statistics in ns. TCA0 counter, same timebase as the section profiler
+	#define SCHED_NS_PER_CNT		200
+	static_assert( SCHED_NS_PER_CNT == (1000000000UL /PWM_TCA_HZ), "SCHED_NS_PER_CNT must follow the TCA prescaler" );
+	//TCA0 counts in a system tick, rounded. 9765.625
+	#define SCHED_TCA_CNT_PER_TICK	((uint16_t)((1000000000UL /SYSTEM_TICK_HZ +SCHED_NS_PER_CNT /2) /SCHED_NS_PER_CNT))
+	//Maximum number of late system ticks executed in a single pass. Older ticks are dropped
+	#define SCHED_MAX_CATCHUP		4
+
+		///----------------------------------------------------------------------
+		///	WATCHDOG
+		///----------------------------------------------------------------------
+
+	//Watchdog period. About 128ms of the 1KHz ULP oscillator, 64 system ticks
+	#define WDT_PERIOD				WDT_PERIOD_128CLK_gc
+	//Heartbeats. The watchdog is fed once all of them checked in since the last feed
+	#define WDT_BEAT_TICK			0	//A system tick has been served
+	#define WDT_BEAT_RX				1	//The RX buffers have been drained
+	#define WDT_BEAT_TX				2	//The TX buffers are empty or a byte was sent
+	#define WDT_BEAT_ALL			0x07
+	//Frame type of the reset cause reply. Payload: RSTFR, BEATS, CMDERR
+	#define TELEMETRY_TYPE_RESET	'R'
+	#define TELEMETRY_RESET_LEN		3
+
+		///----------------------------------------------------------------------
+		///	SEQUENCE NUMBERS
+		///----------------------------------------------------------------------
+
+	//Status of the sequence number prefix of a port
+	#define SEQ_IDLE			0	//No sequence number pending
+	#define SEQ_ARMED_NOW		1	//The SEQ prefix itself is being terminated
+	#define SEQ_ARMED			2	//The next command carries the pending sequence number
+	//Number of sequence numbers past ACK BASE tracked by the RX mask
+	#define SEQ_WINDOW			8
 
 	/****************************************************************************
 	**	MACRO
@@ -69,6 +392,14 @@
 	#define LED0_TOGGLE()	\
 		TOGGLE_BIT( PORTB, PB6 )
 
+		///----------------------------------------------------------------------
+		///	WATCHDOG
+		///----------------------------------------------------------------------
+
+	//Check in a heartbeat of the watchdog
+	#define WDT_BEAT( beat )	\
+		SET_BIT( g_wdt_beat, (beat) )
+
 	/****************************************************************************
 	**	TYPEDEF
 	****************************************************************************/
@@ -76,8 +407,46 @@
 	//Global flags raised by ISR functions
 	typedef struct _Isr_flags Isr_flags;
 	
-	//PWM and direction of a DC motor
-	typedef struct _Dc_motor_pwm Dc_motor_pwm;
+	//PWM and direction of the DC motors
+	typedef struct _Dc_motor_state Dc_motor_state;
+
+	//Stop and reversal modes of the DC motors
+	typedef struct _Motor_stop Motor_stop;
+
+	//Sequence number tracker of an USART port
+	typedef struct _Seq_status Seq_status;
+
+	//Replies to the queries waiting for room in the TX buffer of an USART port
+	typedef struct _Reply_status Reply_status;
+
+	//USART peripheral bundled with its buffers and command parser
+	typedef struct _Uart_port Uart_port;
+
+	//Timing statistics of a scheduler task
+	typedef struct _Task_stats Task_stats;
+
+	//Entry of the scheduler task table
+	typedef struct _Task Task;
+
+	//Velocity loop of a wheel
+	typedef struct _Speed_ctrl Speed_ctrl;
+
+	//Ramp generators of the motors
+	typedef struct _Trajectory Trajectory;
+
+	//Pins and timer of a VNH7040 driver
+	typedef struct _Vnh7040_desc Vnh7040_desc;
+
+	//Geometry and limits of the platform
+	typedef struct _Kinematics Kinematics;
+
+	//Current limit stage of the motors
+	typedef struct _Current_limit Current_limit;
+
+	//Fault flags and readings of the drivers
+	typedef struct _Diag Diag;
+	//Tiers of the communication timeout
+	typedef struct _Com_timeout Com_timeout;
 
 	/****************************************************************************
 	**	STRUCTURE
@@ -86,16 +455,140 @@
 	//Global flags raised by ISR functions
 	struct _Isr_flags
 	{
-		//First byte
-		U8 system_tick	: 1;	//System Tick
-		U8 				: 7;	//unused bits
+		U8 tick_cnt;			//System ticks raised by the RTC PIT ISR. Wraps around
+	};
+
+	//PWM and direction of the DC motors. One array per field, indexed by motor
+	struct _Dc_motor_state
+	{
+		uint16_t pwm[DC_MOTOR_NUM];		//DC Motor duty setting. Q8 PWM. 0x0000 = stop | 0xff00 = maximum
+		uint8_t f_dir[DC_MOTOR_NUM];	//DC Motor direction. false=clockwise | true=counterclockwise
+		uint8_t f_brake[DC_MOTOR_NUM];	//DC Motor active brake. INA = INB = 0, PWM is the braking strength
+	};
+
+	//Stop and reversal modes of the DC motors. One array per field, indexed by motor
+	struct _Motor_stop
+	{
+		uint8_t stop_mode[DC_MOTOR_NUM];	//MOTOR_STOP_RAMP | MOTOR_STOP_COAST | MOTOR_STOP_BRAKE
+		uint8_t reverse_mode[DC_MOTOR_NUM];	//MOTOR_REVERSE_RAMP | MOTOR_REVERSE_BRAKE
+		uint8_t brake_pwm[DC_MOTOR_NUM];	//PWM of the active brake
+		uint8_t brake_cnt[DC_MOTOR_NUM];	//System ticks left of the active brake of a reversal
+	};
+
+	//Sequence number tracker of an USART port
+	struct _Seq_status
+	{
+		uint8_t ack_base;		//Next sequence number expected in order. All the previous ones have been applied
+		uint8_t rx_mask;		//bit n = sequence number ack_base +1 +n has been applied out of order
+		uint8_t seq;			//Sequence number of the command being decoded
+		uint8_t armed		: 2;	//SEQ_IDLE | SEQ_ARMED_NOW | SEQ_ARMED
+		uint8_t f_reply		: 1;	//An ACK/NAK reply is due
+		uint8_t f_fail		: 1;	//A sequence numbered command failed since the last reply
+		uint8_t				: 4;	//unused bits
+	};
+
+	//Replies to the queries waiting for room in the TX buffer of an USART port
+	struct _Reply_status
+	{
+		uint8_t pending;					//bit n = a reply to query REPLY_xxx n is due
+		uint16_t arg_mask[REPLY_NUM];		//bit n = the reply to argument n of the query is due
+	};
+
+	//USART peripheral bundled with its buffers and command parser
+	struct _Uart_port
+	{
+		USART_t *usart;					//USART peripheral. nullptr = port not initialized
+		volatile At_buf8_safe rx_buf;	//Safe circular buffer for RX data. Filled by the RX ISR
+		At_buf8 tx_buf;					//Circular buffer for TX data. Drained by the main loop
+		Orangebot::Uniparser parser;	//Command parser fed with the RX data
+		Seq_status seq;					//Sequence numbers of the commands received on this port
+		Reply_status reply;				//Replies to the queries received on this port
+	};
+
+	//Timing statistics of a scheduler task. Times in TCA0 counts, 200ns. The counter wraps every 13.1ms
+	struct _Task_stats
+	{
+		uint16_t num_exe;		//Number of executions. Wraps around
+		uint16_t exe_min;		//Minimum execution time
+		uint16_t exe_max;		//Maximum execution time
+		uint16_t lat_min;		//Minimum latency from the system tick
+		uint16_t lat_max;		//Maximum latency from the system tick
+	};
+
+	//Entry of the scheduler task table
+	struct _Task
+	{
+		void (*handler)( void );	//Task body. Runs to completion
+		uint8_t period;				//Period in system ticks. 0 = task disabled
+		uint8_t phase;				//System ticks before the first execution. Must be less than the period
+		uint8_t priority;			//Tasks due on the same tick run in increasing priority value
+		uint8_t cnt;				//System ticks left before the next execution
+		Task_stats stats;			//Timing statistics
+	};
+
+	//Velocity loop of a wheel. Speeds in mm/s, forward positive
+	struct _Speed_ctrl
+	{
+		int16_t target;			//Target speed
+		int16_t speed;			//Speed measured over the last period
+		int16_t enc_last;		//Encoder counter at the end of the last period
+		int32_t integral;		//Integrator of the PI. Q8 PWM
+	};
+
+	//Ramp generators of the motors. One array per field, indexed by motor. PWM in Q8, positive = f_dir true
+	struct _Trajectory
+	{
+		int32_t value[DC_MOTOR_NUM];	//Output PWM
+		int32_t rate[DC_MOTOR_NUM];		//Change of the output in the last tick
+		uint16_t accel[DC_MOTOR_NUM];	//Maximum change per tick while the magnitude grows
+		uint16_t decel[DC_MOTOR_NUM];	//Maximum change per tick while the magnitude shrinks
+		uint16_t jerk[DC_MOTOR_NUM];	//Maximum change of the rate per tick. 0 = linear ramps
+	};
+
+	//Pins and timer of a VNH7040 driver. Constant pointers to the peripherals can't be constexpr
+	struct _Vnh7040_desc
+	{
+		PORT_t *port;			//Port of INA and INB
+		uint8_t ina_mask;		//INA, SEL0. Set for f_dir = true
+		uint8_t inb_mask;		//INB. Set for f_dir = false
+		TCB_t *pwm_timer;		//Timer type B generating the PWM
+	};
+
+	//Tiers of the communication timeout. Silence in timeout_task periods
+	struct _Com_timeout
+	{
+		uint8_t hold;			//Silence before the last setpoint is held
+		uint8_t decel;			//Silence before the motors ramp down
+		uint8_t stop;			//Silence before the motors are cut
+		uint8_t tier;			//Current tier. COM_TIER_xxx
+	};
+
+	//Geometry and limits of the platform
+	struct _Kinematics
+	{
+		uint16_t track;			//Distance between the left and right wheels. mm
+		uint16_t max_speed;		//Maximum speed of a side. mm/s
+		uint16_t max_curvature;	//Maximum curvature of the path. mrad/m. 0 = no limit
+	};
+
+	//Current limit stage of the motors. One array per field, indexed by motor
+	struct _Current_limit
+	{
+		uint16_t limit[DC_MOTOR_NUM];	//Continuous current limit. mA. 0 = disabled
+		uint16_t trip[DC_MOTOR_NUM];	//Trip current of the fast path. mA. 0 = disabled
+		uint16_t scale[DC_MOTOR_NUM];	//Scale of the PWM. Q8, CURRENT_SCALE_FULL = no limit
+		uint8_t hold[DC_MOTOR_NUM];		//System ticks left before a tripped motor restarts
 	};
 
-	//PWM and direction of a DC motor
-	struct _Dc_motor_pwm
+	//Fault flags and readings of the drivers. One array per field, indexed by driver
+	struct _Diag
 	{
-		uint8_t pwm;			//DC Motor PWM setting. 0x00 = stop | 0xff = maximum
-		uint8_t f_dir;			//DC Motor direction. false=clockwise | true=counterclockwise
+		uint8_t fault[DC_MOTOR_NUM];	//bit n = DIAG_FAULT_n
+		uint8_t f_vcc[DC_MOTOR_NUM];	//SEL0 in the last window. false = TCHIP | true = VCC
+		uint16_t tchip[DC_MOTOR_NUM];	//Last TCHIP reading. mV
+		uint16_t vcc[DC_MOTOR_NUM];		//Last VCC reading. mV
+		uint8_t window_cnt;				//Windows completed. Wraps around
+		uint8_t skip_cnt;				//Windows skipped for lack of slack. Wraps around
 	};
 
 
@@ -110,6 +603,169 @@
 	**	PROTOTYPE: FUNCTION
 	****************************************************************************/
 
+		///----------------------------------------------------------------------
+		///	USART PORTS
+		///----------------------------------------------------------------------
+
+	//Bind an USART peripheral and its buffer vectors to a port
+	extern void init_uart_port( Uart_port &port, USART_t &usart, uint8_t *rx_vect, uint8_t rx_size, uint8_t *tx_vect, uint8_t tx_size );
+	//Serve all the USART ports. One TX and one RX byte per port per call
+	extern void uart_port_service( void );
+	//Check whether the ports can wait for an interrupt. Arm the TX wake up. false=idle | true=work pending
+	extern bool uart_port_arm_wakeup( void );
+
+		///----------------------------------------------------------------------
+		///	TELEMETRY
+		///----------------------------------------------------------------------
+
+	//Initialize the telemetry stream. Stream starts unsubscribed
+	extern void init_telemetry( void );
+	//Push a binary frame into the TX buffer of a port. false=OK | true=not enough room
+	extern bool send_frame( Uart_port &port, uint8_t type, const uint8_t *payload, uint8_t len );
+	//Called every system tick. Emit a motor state frame when the subscription period expires
+	extern void update_telemetry( void );
+	//Clear the pending replies of a port
+	extern void init_reply( Reply_status &reply );
+	//Answer a query on a port. Deferred until the TX buffer has room for the frame
+	extern void send_reply( Uart_port &port, uint8_t query, uint8_t arg );
+	//Called every system tick. Send the pending replies of each port
+	extern void update_reply( void );
+	//Handler for the telemetry subscription command
+	extern void telemetry_handler( uint8_t period );
+	//Build the board signature reply. Returns its length. See main.cpp
+	extern uint8_t signature_reply( uint8_t arg, uint8_t *payload );
+
+		///----------------------------------------------------------------------
+		///	SEQUENCE NUMBERS
+		///----------------------------------------------------------------------
+
+	//Reset the sequence number tracker of a port
+	extern void init_seq( Seq_status &seq );
+	//Handler for the sequence number prefix command
+	extern void seq_handler( uint8_t seq );
+	//A terminator has been fed to the parser of the port. Account the command against the pending sequence number
+	extern void seq_command_done( Uart_port &port, bool f_executed );
+	//Called every system tick. Send the pending cumulative ACK/NAK of each port
+	extern void update_seq( void );
+
+		///----------------------------------------------------------------------
+		///	SPEED CONTROL
+		///----------------------------------------------------------------------
+
+	//Initialize encoders and velocity loops. Loop starts open
+	extern void init_speed_ctrl( void );
+	//Measure the speed of the wheels and run the velocity loops
+	extern void speed_ctrl_task( void );
+	//Handler for the platform velocity command. Closes the velocity loops
+	extern void platform_velocity_handler( int16_t right, int16_t left );
+	//Handler for the velocity loop gain command
+	extern void speed_gain_handler( int16_t kp, int16_t ki );
+
+		///----------------------------------------------------------------------
+		///	KINEMATICS
+		///----------------------------------------------------------------------
+
+	//Load the default geometry and limits of the platform
+	extern void init_kinematics( void );
+	//Mix linear and angular velocity into the speed of the two sides
+	extern void kinematics_mix( int16_t linear, int16_t angular, int16_t &right, int16_t &left );
+	//Set the target duty of the motors of the two sides. Q8 PWM. Open loop
+	extern void set_platform_pwm( int32_t right, int32_t left );
+	//Set the target speed of the wheels of the two sides. Closes the velocity loops
+	extern void set_platform_speed( int16_t right, int16_t left );
+	//Handler for the platform twist command. Closed loop
+	extern void platform_twist_handler( int16_t linear, int16_t angular );
+	//Handler for the platform twist command. Open loop
+	extern void platform_twist_pwm_handler( int16_t linear, int16_t angular );
+	//Handler for the kinematics configuration command
+	extern void kinematics_handler( uint16_t track, uint16_t max_speed, uint16_t max_curvature );
+
+		///----------------------------------------------------------------------
+		///	CURRENT SENSE
+		///----------------------------------------------------------------------
+
+	//Initialize running sums and filters of the motor currents. Before init_adc
+	extern void init_current( void );
+	//Called every system tick. Decimate the ADC running sums and filter the motor currents
+	extern void update_current( void );
+	//Build the payload of the motor current frame. Returns the payload length
+	extern uint8_t current_reply( uint8_t arg, uint8_t *payload );
+	//Handler for the motor current query
+	extern void current_handler( void );
+	//Convert a trip current in mA to the threshold compared by the ADC ISR
+	extern uint16_t current_trip_adc( uint16_t trip );
+	//Current limit stage between the ramp generator and the driver. Returns the allowed PWM
+	extern int32_t current_limit_step( uint8_t index, int32_t value );
+	//Handler for the current limit configuration command
+	extern void current_limit_handler( uint16_t index, uint16_t limit, uint16_t trip );
+
+		///----------------------------------------------------------------------
+		///	DRIVER DIAGNOSTIC
+		///----------------------------------------------------------------------
+
+	//Initialize the diagnostic of the drivers
+	extern void init_diag( void );
+	//Decode the last diagnostic window and open a new one if there is slack
+	extern void diag_task( void );
+	//Build the payload of the driver diagnostic frame. Returns the payload length
+	extern uint8_t diag_reply( uint8_t arg, uint8_t *payload );
+	//Handler for the driver diagnostic query
+	extern void diag_handler( void );
+
+		///----------------------------------------------------------------------
+		///	TRAJECTORY
+		///----------------------------------------------------------------------
+
+	//Initialize the ramp generators
+	extern void init_trajectory( void );
+	//Advance the ramp generator of a motor by one system tick. Returns the output PWM
+	extern int32_t trajectory_step( uint8_t index, int32_t target );
+	//Handler for the trajectory limits command
+	extern void trajectory_handler( uint16_t index, uint16_t accel, uint16_t decel, uint16_t jerk );
+
+	#ifdef ENABLE_PWM_CHECK
+	//trajectory_step checked against the version it replaced
+	extern int32_t pwm_check_ramp( uint8_t index, int32_t target );
+	//Check the drivers against a write of all the channels. Call at the end of update_pwm
+	extern void pwm_check_drivers( uint8_t change );
+	#endif
+
+		///----------------------------------------------------------------------
+		///	SCHEDULER
+		///----------------------------------------------------------------------
+
+	//Sort the task table by priority, load the phases and clear the statistics
+	extern void init_scheduler( Task *table, uint8_t num );
+	//Called by the main loop. Run the tasks of the system ticks elapsed since the last call
+	extern void scheduler_service( void );
+	//Build the payload of the task statistics frame. Returns the payload length
+	extern uint8_t task_stats_reply( uint8_t index, uint8_t *payload );
+	//Handler for the task statistics query
+	extern void task_stats_handler( uint8_t index );
+	//Build the payload of the system tick statistics frame. Returns the payload length
+	extern uint8_t tick_stats_reply( uint8_t arg, uint8_t *payload );
+	//Handler for the system tick statistics query
+	extern void tick_stats_handler( void );
+	//Called by the main loop. Sleep until the next interrupt if there is no work pending
+	extern void scheduler_idle( void );
+	//RTC counts left before the next system tick. 0 = the main loop is late
+	extern uint16_t scheduler_slack( void );
+	//Compute the idle time percentage over the last window
+	extern void idle_task( void );
+
+		///----------------------------------------------------------------------
+		///	WATCHDOG
+		///----------------------------------------------------------------------
+
+	//Record the cause of the last reset. First thing at boot, before init
+	extern void init_watchdog( void );
+	//Called by the main loop. Feed the watchdog once all the heartbeats checked in
+	extern void watchdog_service( void );
+	//Build the payload of the reset cause frame. Returns the payload length
+	extern uint8_t reset_cause_reply( uint8_t arg, uint8_t *payload );
+	//Handler for the reset cause query
+	extern void reset_cause_handler( void );
+
 	/****************************************************************************
 	**	PROTOTYPE: GLOBAL VARIABILE
 	****************************************************************************/
@@ -122,27 +778,270 @@
 	extern volatile	Isr_flags g_isr_flags;
 	
 		///----------------------------------------------------------------------
-		///	BUFFERS
+		///	USART PORTS
 		///----------------------------------------------------------------------
-		//	Buffers structure and data vectors
 
-	//Safe circular buffer for UART input data
-	extern volatile At_buf8_safe rpi_rx_buf;
-	//Safe circular buffer for uart tx data
-	extern At_buf8 rpi_tx_buf;
-	//allocate the working vector for the buffer
-	extern uint8_t v0[ RPI_RX_BUF_SIZE ];
-	//allocate the working vector for the buffer
-	extern uint8_t v1[ RPI_TX_BUF_SIZE ];
+	//USART ports with their buffers and parsers
+	extern Uart_port g_uart_port[ UART_PORT_NUM ];
+	//Port whose parser is running. Lets handlers know where the command came from
+	extern Uart_port *g_uart_port_active;
 	
+		///--------------------------------------------------------------------------
+		///	PARSER
+		///--------------------------------------------------------------------------
+
+	//communication timeout counter
+	extern U8 uart_timeout_cnt;
+	//Communication timeout has been detected
+	extern bool f_timeout_detected;
+	//Tiers of the communication timeout
+	extern Com_timeout com_timeout;
+	//System ticks elapsed since boot. Timestamp of the telemetry frames
+	extern uint16_t g_tick_cnt;
+	//Commands the parser refused at boot
+	extern uint8_t g_parser_err;
+
+		///--------------------------------------------------------------------------
+		///	SCHEDULER
+		///--------------------------------------------------------------------------
+
+	//RTC counter sampled by the RTC PIT ISR on the last system tick
+	extern volatile uint16_t g_tick_timestamp;
+	//TCA0 counter sampled by the RTC PIT ISR on the last system tick
+	extern volatile uint16_t g_tick_tca;
+
+		///--------------------------------------------------------------------------
+		///	WATCHDOG
+		///--------------------------------------------------------------------------
+
+	//Heartbeats checked in since the last feed. Survives a watchdog reset
+	extern uint8_t g_wdt_beat;
+
 		///--------------------------------------------------------------------------
 		///	MOTORS
 		///--------------------------------------------------------------------------
 
 	//Desired setting for the DC motor channels
-	extern Dc_motor_pwm dc_motor_target[DC_MOTOR_NUM];
-	//Two DC Motor channels current setting
-	extern Dc_motor_pwm dc_motor[DC_MOTOR_NUM];
+	extern Dc_motor_state dc_motor_target;
+	//DC Motor channels current setting. Mirrors the drivers
+	extern Dc_motor_state dc_motor;
+	//Pins and timers of the VNH7040 drivers
+	extern const Vnh7040_desc vnh7040_desc[DC_MOTOR_NUM];
+	//Stop and reversal modes of the DC motors
+	extern Motor_stop motor_stop;
+	//Integer part of the duty of the drivers. Read by the dither ISR
+	extern volatile uint8_t g_pwm_base[DC_MOTOR_NUM];
+	//Fraction of the duty of the drivers. Read by the dither ISR
+	extern volatile uint8_t g_pwm_frac[DC_MOTOR_NUM];
+	//Dither accumulators. Written by the dither ISR
+	extern volatile uint8_t g_pwm_acc[DC_MOTOR_NUM];
+	//Compare last written in the timer of each driver
+	extern volatile uint8_t g_pwm_duty[DC_MOTOR_NUM];
+
+		///--------------------------------------------------------------------------
+		///	SPEED CONTROL
+		///--------------------------------------------------------------------------
+
+	//Quadrature decoder. Index is OLD B, OLD A, NEW B, NEW A
+	extern const int8_t enc_lut[16];
+	//Encoder counters. Written by the PORTC pin change ISR
+	extern volatile int16_t g_enc_cnt[DC_MOTOR_NUM];
+	//PORTC pins at the previous pin change
+	extern volatile uint8_t g_enc_pins;
+	//Velocity loop of the wheels
+	extern Speed_ctrl speed_ctrl[DC_MOTOR_NUM];
+	//Closed loop mode. false = the commands set the target PWM directly
+	extern bool f_speed_ctrl;
+	//Direction of each motor that moves the platform forward
+	extern const bool speed_ctrl_fwd_dir[DC_MOTOR_NUM];
+
+		///--------------------------------------------------------------------------
+		///	KINEMATICS
+		///--------------------------------------------------------------------------
+
+	//Geometry and limits of the platform
+	extern Kinematics kinematics;
+	//Side of each motor. true = right side
+	extern const bool kinematics_f_right[DC_MOTOR_NUM];
+
+		///--------------------------------------------------------------------------
+		///	CURRENT SENSE
+		///--------------------------------------------------------------------------
+
+	//Running sums of the ADC results. Written by the ADC ISR
+	extern volatile uint16_t g_adc_sum[DC_MOTOR_NUM];
+	//Number of ADC results inside the running sums
+	extern volatile uint8_t g_adc_num[DC_MOTOR_NUM];
+	//Channel of the next ADC result. CURRENT_ADC_CH_BOOT until the first result
+	extern volatile uint8_t g_adc_ch;
+	//Low pass filter of the sense of the motors. ADC results. Q3
+	extern uint16_t current_filter[DC_MOTOR_NUM];
+	//Filtered motor currents. mA
+	extern uint16_t motor_current[DC_MOTOR_NUM];
+	//Trip thresholds as ADC results. Read by the ADC ISR. 0xffff = disabled
+	extern volatile uint16_t g_adc_trip[DC_MOTOR_NUM];
+	//bit n = the ADC ISR tripped motor n
+	extern volatile uint8_t g_adc_trip_mask;
+	//Current limit stage of the motors
+	extern Current_limit current_limit;
+
+		///--------------------------------------------------------------------------
+		///	DRIVER DIAGNOSTIC
+		///--------------------------------------------------------------------------
+
+	//Status of the diagnostic window. Shared with the ADC ISR
+	extern volatile uint8_t g_diag_state;
+	//ADC results still to be discarded while the MultiSense settles
+	extern volatile uint8_t g_diag_cnt;
+	//ADC results captured in the window
+	extern volatile uint8_t g_diag_num;
+	//ADC results captured in the window. One per channel
+	extern volatile uint16_t g_diag_res[DC_MOTOR_NUM];
+	//Fault flags and readings of the drivers
+	extern Diag diag;
+
+		///--------------------------------------------------------------------------
+		///	TRAJECTORY
+		///--------------------------------------------------------------------------
+
+	//Ramp generators of the motors
+	extern Trajectory trajectory;
+
+		///----------------------------------------------------------------------
+		///	INLINE FUNCTIONS
+		///----------------------------------------------------------------------
+
+	//Generic RX ISR body. Fetch the byte, which clears the interrupt flag, and push it in the RX buffer of the port
+	inline void uart_port_rx_isr( Uart_port &port )
+	{
+		uint8_t rx_data_tmp = port.usart -> RXDATAL;
+		AT_BUF_PUSH_SAFER( port.rx_buf, rx_data_tmp );
+	}
+
+	//Generic DRE ISR body. Disarm the interrupt, it's only used to wake up the main loop
+	inline void uart_port_dre_isr( Uart_port &port )
+	{
+		CLEAR_BIT( port.usart -> CTRLA, USART_DREIE_bp );
+	}
+
+	//PORTC pin change ISR body. Decode the transitions of the four encoders. Two pins each
+	inline void encoder_isr( uint8_t pins )
+	{
+		uint8_t pins_old = g_enc_pins;
+		g_enc_pins = pins;
+		for (uint8_t t = 0;t < DC_MOTOR_NUM;t++)
+		{
+			g_enc_cnt[t] += enc_lut[ ((pins_old & 0x03) << 2) | (pins & 0x03) ];
+			pins_old >>= 2;
+			pins >>= 2;
+		}
+	}
+
+	//Write the compare of the timer of a driver. CCMPL is written too,
+	//a write of CCMPH alone would commit whatever the TEMP register holds in CCMPL
+	inline void pwm_write( uint8_t index, uint8_t duty )
+	{
+		vnh7040_desc[index].pwm_timer -> CCMP = ((uint16_t)duty << 8) | PWM_TOP;
+		g_pwm_duty[index] = duty;
+	}
+
+	//ADC ISR body inside the diagnostic window. Discard while the MultiSense settles,
+	//capture one result per channel, lower SEL1, settle again and go back to the current sense
+	inline void diag_isr( uint8_t ch, uint16_t res )
+	{
+		if (g_diag_cnt > 0)
+		{
+			g_diag_cnt--;
+		}
+		else if (g_diag_state == DIAG_RECOVER)
+		{
+			g_diag_state = DIAG_DONE;
+		}
+		else
+		{
+			g_diag_res[ch] = res;
+			g_diag_num++;
+			if (g_diag_num >= DC_MOTOR_NUM)
+			{
+				PORTF.OUTCLR = DIAG_SEL1_bm;
+				g_diag_state = DIAG_RECOVER;
+				g_diag_cnt = DIAG_SETTLE_NUM -1;
+			}
+		}
+	}
+
+	//ADC result ready ISR body. The conversion after this one has already started on the next channel,
+	//program the one after it. Trip the motor above the threshold. Add the result to the running sum of its channel
+	inline void adc_isr( void )
+	{
+		uint16_t res = ADC0.RES;
+		uint8_t ch = g_adc_ch;
+		//First result after boot. MUXPOS could only be moved now, so the conversion that
+		//has just started is on AIN0 as well. Discard this one and resync the scan
+		if (ch == CURRENT_ADC_CH_BOOT)
+		{
+			ADC0.MUXPOS = ADC_MUXPOS_AIN0_gc +(1 % DC_MOTOR_NUM);
+			g_adc_ch = 0;
+			return;
+		}
+		ADC0.MUXPOS = ADC_MUXPOS_AIN0_gc +((ch +2) % DC_MOTOR_NUM);
+		g_adc_ch = (ch +1) % DC_MOTOR_NUM;
+		if (g_diag_state >= DIAG_SAMPLE)
+		{
+			diag_isr( ch, res );
+			return;
+		}
+		if (res > g_adc_trip[ch])
+		{
+			//The dither ISR must not bring the PWM back
+			g_pwm_base[ch] = 0;
+			g_pwm_frac[ch] = 0;
+			pwm_write( ch, 0 );
+			SET_BIT( g_adc_trip_mask, ch );
+		}
+		if (g_adc_num[ch] < CURRENT_SUM_MAX_NUM)
+		{
+			g_adc_sum[ch] += res;
+			g_adc_num[ch]++;
+		}
+	}
+
+	//Duty, Q8 of a 256 count period, to Q8 counts of the timers type B. Identity for an 8bit period
+	inline uint16_t pwm_duty_cnt( uint16_t duty )
+	{
+		return (PWM_TOP == 255)?(duty):((uint16_t)(((uint32_t)duty *((uint16_t)PWM_TOP +1)) >> 8));
+	}
+
+	//TCB0 period ISR body. First order sigma delta of the fraction of each duty.
+	//A period gets one more PWM count when the accumulator of the fraction carries.
+	//The ISR runs early in the period. A compare moved behind the counter while the pulse
+	//is still on would stretch it to the whole period, so that step is held for one period
+	inline void pwm_dither_isr( void )
+	{
+		//All the timers type B count CLK_TCA in phase, they are restarted together with TCA0 by init
+		uint8_t cnt = TCB0.CNTL;
+		for (uint8_t t = 0;t < DC_MOTOR_NUM;t++)
+		{
+			uint16_t acc = g_pwm_acc[t] +g_pwm_frac[t];
+			uint8_t duty = g_pwm_base[t] +(uint8_t)(acc >> 8);
+			if ((duty < g_pwm_duty[t]) && ((uint16_t)duty <= (uint16_t)cnt +PWM_ISR_GUARD_CNT) && (g_pwm_duty[t] > cnt))
+			{
+				continue;
+			}
+			g_pwm_acc[t] = (uint8_t)acc;
+			pwm_write( t, duty );
+		}
+	}
+
+	//Read a 16bit register or variable shared with the ISRs. The two bytes can't be split by an interrupt
+	inline uint16_t atomic_read_u16( volatile uint16_t &data )
+	{
+		uint8_t sreg_tmp = SREG;
+		cli();
+		uint16_t data_tmp = data;
+		SREG = sreg_tmp;
+		return data_tmp;
+	}
 
 #else
 	#warning "multiple inclusion of the header file global.h"
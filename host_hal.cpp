@@ -0,0 +1,629 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	HOST HARDWARE ABSTRACTION LAYER
+*****************************************************************
+**	Compiled in host builds only. The registers of the AT4809 are
+**	plain variables declared in host_hal.h, this file simulates
+**	the peripherals the main loop waits on, so the firmware runs
+**	unchanged on the host and can be driven and profiled by piping
+**	commands in it.
+**
+**		TIME
+**	Time is simulated and only moves when the firmware sleeps,
+**	waits on a timer counter or calls _delay_xx. A run is
+**	deterministic and not paced to the wall clock: it goes as fast
+**	as the host can execute the main loop.
+**
+**		SIMULATED PERIPHERALS
+**	RTC		: CNT follows the time. PIT interrupt at the period of PITCTRLA
+**	TCA0	: CNT follows the time
+**	TCB0..3	: CNTL follows the time in 8bit PWM mode. TCB0 CAPT interrupt
+**	USART3	: RX bytes come from stdin, TX bytes go to stdout, one
+**			byte time each at the baud rate of BAUD
+**	ADC0	: free running result ready interrupt. The result of a
+**			channel is g_hal_adc[ channel ], set by tests
+**	WDT		: the firmware exits with HAL_EXIT_WDT if it isn't fed in time
+**	PORTC pin change interrupts aren't simulated, tests can call
+**	PORTC_PORT_vect after writing PORTC.IN.
+**
+**		INTERRUPTS
+**	sleep_cpu serves the first pending interrupt, moving the time
+**	to it if needed, then returns to the main loop. Interrupts are
+**	served only if sei() was called. Sleeping with nothing that can
+**	wake the CPU up exits with HAL_EXIT_HANG.
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+#ifndef __AVR__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/****************************************************************
+**	DEFINES
+****************************************************************/
+
+//Event that is not scheduled
+#define HAL_NEVER			UINT64_MAX
+//No byte is waiting to be received
+#define HAL_RX_NONE			-1
+//ns in a s
+#define HAL_NS_PER_S		1000000000ULL
+//Bits on the line for a byte. START, 8 DATA, STOP
+#define HAL_USART_BIT_NUM	10
+//ADC clock cycles for a conversion at 10bit
+#define HAL_ADC_CONV_CYC	13
+
+#define HAL_MIN( a, b )		\
+	(((a) < (b))?(a):(b))
+
+#define HAL_MAX( a, b )		\
+	(((a) > (b))?(a):(b))
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Register blocks
+register8_t SREG;
+register8_t CCP;
+PORT_t PORTA, PORTB, PORTC, PORTD, PORTE, PORTF;
+TCA_t TCA0;
+TCB_t TCB0, TCB1, TCB2, TCB3;
+USART_t USART0, USART1, USART2, USART3;
+RTC_t RTC;
+CLKCTRL_t CLKCTRL;
+PORTMUX_t PORTMUX;
+SLPCTRL_t SLPCTRL;
+WDT_t WDT;
+RSTCTRL_t RSTCTRL;
+ADC_t ADC0;
+VREF_t VREF;
+
+//Simulated time since reset. ns
+uint64_t g_hal_ns = 0;
+//Result of the ADC for each MUXPOS channel
+uint16_t g_hal_adc[ 16 ];
+
+//Time of the next PIT interrupt
+static uint64_t g_hal_pit_ns = HAL_NEVER;
+//Time the byte in the USART3 transmitter is done
+static uint64_t g_hal_tx_ns = HAL_NEVER;
+//Time the next byte from stdin is received
+static uint64_t g_hal_rx_ns = HAL_NEVER;
+//Time the line is free for the next RX byte
+static uint64_t g_hal_rx_free_ns = 0;
+//Next byte from stdin. HAL_RX_NONE if not read yet
+static int g_hal_rx_data = HAL_RX_NONE;
+//stdin is over
+static bool g_hal_f_eof = false;
+//PIT interrupts since the end of stdin
+static uint32_t g_hal_eof_tick = 0;
+//Time of the next ADC result
+static uint64_t g_hal_adc_ns = HAL_NEVER;
+//Channel of the conversion in progress. MUXPOS is latched when a conversion starts
+static uint8_t g_hal_adc_ch = 0;
+//Time of the next TCB0 CAPT interrupt
+static uint64_t g_hal_tcb_ns = HAL_NEVER;
+//Time of the last watchdog feed
+static uint64_t g_hal_wdt_ns = 0;
+
+/****************************************************************
+** FUNCTIONS
+****************************************************************/
+
+/****************************************************************************
+**  Function
+**  hal_reset
+****************************************************************************/
+//! @return void |
+//! @brief Reset values of the registers that aren't zero. Runs before main
+/***************************************************************************/
+
+__attribute__ ((constructor)) static void hal_reset( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Power on reset
+	RSTCTRL.RSTFR = RSTCTRL_PORF_bm;
+	//Transmitters are empty
+	USART0.STATUS = USART_DREIF_bm;
+	USART1.STATUS = USART_DREIF_bm;
+	USART2.STATUS = USART_DREIF_bm;
+	USART3.STATUS = USART_DREIF_bm;
+	RTC.PER = (uint16_t)0xffff;
+	TCA0.SINGLE.PER = (uint16_t)0xffff;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: hal_reset
+
+/****************************************************************************
+**  Function
+**  hal_cpu_cyc
+****************************************************************************/
+//! @return uint64_t | CPU clock cycles since reset
+//! @brief F_CPU must be a multiple of 1MHz
+/***************************************************************************/
+
+static uint64_t hal_cpu_cyc( void )
+{
+	return g_hal_ns *(F_CPU /1000000UL) /1000;
+}	//End: hal_cpu_cyc
+
+/****************************************************************************
+**  Function
+**  hal_cyc_ns | uint64_t
+****************************************************************************/
+//! @param cyc	| CPU clock cycles
+//! @return uint64_t | ns
+//! @brief Convert CPU clock cycles in ns
+/***************************************************************************/
+
+static uint64_t hal_cyc_ns( uint64_t cyc )
+{
+	return cyc *1000 /(F_CPU /1000000UL);
+}	//End: hal_cyc_ns
+
+/****************************************************************************
+**  Function
+**  hal_tca_shift
+****************************************************************************/
+//! @return uint8_t | TCA0 prescaler as a power of two
+/***************************************************************************/
+
+static uint8_t hal_tca_shift( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//Prescaler for each value of CLKSEL
+	static const uint8_t shift[ 8 ] = { 0, 1, 2, 3, 4, 6, 8, 10 };
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return shift[ (TCA0.SINGLE.CTRLA & TCA_SINGLE_CLKSEL_gm) >> TCA_SINGLE_CLKSEL_gp ];
+}	//End: hal_tca_shift
+
+/****************************************************************************
+**  Function
+**  hal_update
+****************************************************************************/
+//! @return void |
+//! @brief Update the counters and the flags that follow the time
+//! @details A polled transmitter sees DREIF without sleeping
+/***************************************************************************/
+
+static void hal_update( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//TCA0 clock cycles since reset
+	uint64_t tca_cyc = hal_cpu_cyc() >> hal_tca_shift();
+	//RTC clock cycles since reset
+	uint64_t rtc_cyc = g_hal_ns *HAL_RTC_HZ /HAL_NS_PER_S;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	if (IS_BIT_ONE( RTC.CTRLA, RTC_RTCEN_bp ))
+	{
+		RTC.CNT = (uint16_t)((rtc_cyc >> ((RTC.CTRLA & RTC_PRESCALER_gm) >> RTC_PRESCALER_gp)) % ((uint32_t)RTC.PER +1));
+	}
+	if (IS_BIT_ONE( TCA0.SINGLE.CTRLA, TCA_SINGLE_ENABLE_bp ))
+	{
+		TCA0.SINGLE.CNT = (uint16_t)(tca_cyc % ((uint32_t)TCA0.SINGLE.PER +1));
+	}
+	if (g_hal_ns >= g_hal_tx_ns)
+	{
+		g_hal_tx_ns = HAL_NEVER;
+		SET_BIT( USART3.STATUS, USART_DREIF_bp );
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: hal_update
+
+/****************************************************************************
+**  Function
+**  hal_byte_ns
+****************************************************************************/
+//! @return uint64_t | time on the line of a byte of USART3. ns
+//! @brief Normal speed asynchronous mode. BAUD = 64 *F_CPU /(16 *baud rate)
+/***************************************************************************/
+
+static uint64_t hal_byte_ns( void )
+{
+	return (uint64_t)HAL_USART_BIT_NUM *USART3.BAUD *HAL_NS_PER_S /(4ULL *F_CPU) +1;
+}	//End: hal_byte_ns
+
+/****************************************************************************
+**  Function
+**  hal_pit_ns
+****************************************************************************/
+//! @return uint64_t | period of the PIT interrupt. ns | 0 = PIT is off
+/***************************************************************************/
+
+static uint64_t hal_pit_ns( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	uint8_t period = (RTC.PITCTRLA & RTC_PERIOD_gm) >> RTC_PERIOD_gp;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	if ((IS_BIT_ZERO( RTC.PITCTRLA, RTC_PITEN_bp )) || (period == 0))
+	{
+		return 0;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	//CYC4 is 1
+	return (4ULL << (period -1)) *HAL_NS_PER_S /HAL_RTC_HZ;
+}	//End: hal_pit_ns
+
+/****************************************************************************
+**  Function
+**  hal_adc_ns
+****************************************************************************/
+//! @return uint64_t | time between two results of the free running ADC. ns | 0 = no interrupt
+//! @brief Conversion time of the accumulated samples at 10bit
+/***************************************************************************/
+
+static uint64_t hal_adc_ns( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//CPU clock cycles of a conversion. PRESC DIV2 is 0
+	uint64_t cyc = (uint64_t)HAL_ADC_CONV_CYC << ((ADC0.CTRLC & ADC_PRESC_gm) +1);
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	if ((IS_BIT_ZERO( ADC0.CTRLA, ADC_ENABLE_bp )) || (IS_BIT_ZERO( ADC0.CTRLA, ADC_FREERUN_bp )) || ((ADC0.INTCTRL & ADC_RESRDY_bm) == 0))
+	{
+		return 0;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return hal_cyc_ns( cyc << (ADC0.CTRLB & ADC_SAMPNUM_gm) );
+}	//End: hal_adc_ns
+
+/****************************************************************************
+**  Function
+**  hal_tcb_ns
+****************************************************************************/
+//! @return uint64_t | period of the TCB0 CAPT interrupt. ns | 0 = no interrupt
+//! @brief 8bit PWM mode clocked by TCA0. CAPT fires when the counter wraps
+/***************************************************************************/
+
+static uint64_t hal_tcb_ns( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	if ((IS_BIT_ZERO( TCB0.CTRLA, TCB_ENABLE_bp )) || ((TCB0.INTCTRL & TCB_CAPT_bm) == 0))
+	{
+		return 0;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return hal_cyc_ns( ((uint64_t)TCB0.CCMPL +1) << hal_tca_shift() );
+}	//End: hal_tcb_ns
+
+/****************************************************************************
+**  Function
+**  hal_schedule | uint64_t &, uint64_t
+****************************************************************************/
+//! @param time		| time of the next event of a periodic source
+//! @param period	| period of the source. ns | 0 = off
+//! @return void |
+//! @brief Schedule a source that has just been turned on, forget one turned off
+/***************************************************************************/
+
+static void hal_schedule( uint64_t &time, uint64_t period )
+{
+	if (period == 0)
+	{
+		time = HAL_NEVER;
+	}
+	else if (time == HAL_NEVER)
+	{
+		time = g_hal_ns +period;
+	}
+
+	return;
+}	//End: hal_schedule
+
+/****************************************************************************
+**  Function
+**  hal_exit | int
+****************************************************************************/
+//! @param code	| HAL_EXIT_xxx
+//! @return void |
+//! @brief End the run. Report the cause if it isn't the end of stdin
+/***************************************************************************/
+
+static void hal_exit( int code )
+{
+	if (code == HAL_EXIT_WDT)
+	{
+		fprintf( stderr, "host_hal: watchdog reset at %.3fms\n", g_hal_ns /1000000.0 );
+	}
+	else if (code == HAL_EXIT_HANG)
+	{
+		fprintf( stderr, "host_hal: sleeping with no wake up source at %.3fms\n", g_hal_ns /1000000.0 );
+	}
+	fflush( stdout );
+	exit( code );
+}	//End: hal_exit
+
+/****************************************************************************
+**  Function
+**  hal_busy | uint32_t
+****************************************************************************/
+//! @param ns	| time spent. ns
+//! @return void |
+//! @brief Move the simulated time forward without serving interrupts
+/***************************************************************************/
+
+void hal_busy( uint32_t ns )
+{
+	g_hal_ns += ns;
+	hal_update();
+
+	return;
+}	//End: hal_busy
+
+/****************************************************************************
+**  Function
+**  hal_wdt_reset
+****************************************************************************/
+//! @return void |
+//! @brief Feed the watchdog
+/***************************************************************************/
+
+void hal_wdt_reset( void )
+{
+	g_hal_wdt_ns = g_hal_ns;
+
+	return;
+}	//End: hal_wdt_reset
+
+/****************************************************************************
+**  Function
+**  hal_sleep
+****************************************************************************/
+//! @return void |
+//! @brief Sleep until the next interrupt and serve it
+//! @details Interrupts whose flag is already set are served first. Otherwise the time moves to
+//!	the first scheduled event. Events that don't have their interrupt enabled only set their flag.
+//!	Blocks on stdin while waiting for the next RX byte
+/***************************************************************************/
+
+void hal_sleep( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//Time of the first event
+	uint64_t next;
+	//Watchdog timeout. ns
+	uint64_t wdt_ns;
+	//WDT period
+	uint8_t wdt_period;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//The CPU never wakes up
+	if ((SREG & CPU_I_bm) == 0)
+	{
+		hal_exit( HAL_EXIT_HANG );
+	}
+	hal_update();
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	while (true)
+	{
+		//Level interrupts. Flag set while the interrupt was off
+		if ((IS_BIT_ONE( USART3.STATUS, USART_DREIF_bp )) && (IS_BIT_ONE( USART3.CTRLA, USART_DREIE_bp )))
+		{
+			USART3_DRE_vect();
+			return;
+		}
+		if ((IS_BIT_ONE( USART3.STATUS, USART_RXCIF_bp )) && (IS_BIT_ONE( USART3.CTRLA, USART_RXCIE_bp )))
+		{
+			USART3_RXC_vect();
+			//Reading RXDATAL clears the flag
+			CLEAR_BIT( USART3.STATUS, USART_RXCIF_bp );
+			return;
+		}
+		//Periodic sources turned on or off by the firmware
+		hal_schedule( g_hal_pit_ns, hal_pit_ns() );
+		hal_schedule( g_hal_adc_ns, hal_adc_ns() );
+		hal_schedule( g_hal_tcb_ns, hal_tcb_ns() );
+		//Next RX byte. Paced at the baud rate
+		if ((g_hal_f_eof == false) && (g_hal_rx_data == HAL_RX_NONE) && (IS_BIT_ONE( USART3.CTRLB, USART_RXEN_bp )))
+		{
+			g_hal_rx_data = getchar();
+			if (g_hal_rx_data == EOF)
+			{
+				g_hal_rx_data = HAL_RX_NONE;
+				g_hal_f_eof = true;
+			}
+			else
+			{
+				g_hal_rx_ns = HAL_MAX( g_hal_ns, g_hal_rx_free_ns ) +hal_byte_ns();
+				g_hal_rx_free_ns = g_hal_rx_ns;
+			}
+		}
+		wdt_period = WDT.CTRLA & WDT_PERIOD_gm;
+		wdt_ns = (wdt_period == 0)?(HAL_NEVER):(g_hal_wdt_ns +(8ULL << (wdt_period -1)) *HAL_NS_PER_S /HAL_WDT_HZ);
+		next = HAL_MIN( HAL_MIN( g_hal_pit_ns, g_hal_tx_ns ), HAL_MIN( g_hal_rx_ns, wdt_ns ) );
+		next = HAL_MIN( next, HAL_MIN( g_hal_adc_ns, g_hal_tcb_ns ) );
+		if (next == HAL_NEVER)
+		{
+			hal_exit( HAL_EXIT_HANG );
+		}
+		g_hal_ns = HAL_MAX( g_hal_ns, next );
+		hal_update();
+
+		//The main loop didn't feed the watchdog in time
+		if (next == wdt_ns)
+		{
+			hal_exit( HAL_EXIT_WDT );
+		}
+		//Transmitter done. hal_update set DREIF, DRE is served as a level interrupt
+		else if (next == g_hal_tx_ns)
+		{
+		}
+		else if (next == g_hal_rx_ns)
+		{
+			g_hal_rx_ns = HAL_NEVER;
+			USART3.RXDATAL = (uint8_t)g_hal_rx_data;
+			g_hal_rx_data = HAL_RX_NONE;
+			SET_BIT( USART3.STATUS, USART_RXCIF_bp );
+		}
+		else if (next == g_hal_pit_ns)
+		{
+			g_hal_pit_ns += hal_pit_ns();
+			if ((g_hal_f_eof == true) && (++g_hal_eof_tick >= HAL_EXIT_TICKS))
+			{
+				hal_exit( HAL_EXIT_OK );
+			}
+			RTC.PITINTFLAGS = RTC_PI_bm;
+			if ((RTC.PITINTCTRL & RTC_PI_bm) != 0)
+			{
+				RTC_PIT_vect();
+				return;
+			}
+		}
+		else if (next == g_hal_adc_ns)
+		{
+			g_hal_adc_ns += hal_adc_ns();
+			ADC0.RES = g_hal_adc[ g_hal_adc_ch ];
+			//The next conversion starts on the channel programmed now
+			g_hal_adc_ch = ADC0.MUXPOS & ADC_MUXPOS_gm & 0x0F;
+			ADC0.INTFLAGS = ADC_RESRDY_bm;
+			ADC0_RESRDY_vect();
+			return;
+		}
+		else
+		{
+			g_hal_tcb_ns += hal_tcb_ns();
+			TCB0.INTFLAGS = TCB_CAPT_bm;
+			TCB0_INT_vect();
+			return;
+		}
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: hal_sleep
+
+/****************************************************************************
+**  Function
+**  Hal_tcb_cnt::operator uint8_t
+****************************************************************************/
+//! @return uint8_t | counter of the timer type B. 8bit PWM mode
+//! @brief A busy wait on the counter moves the time forward by HAL_BUSY_NS a read
+/***************************************************************************/
+
+Hal_tcb_cnt::operator uint8_t( void ) const
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//timer of the counter
+	const TCB_t *tcb = (this == &TCB0.CNTL)?(&TCB0):((this == &TCB1.CNTL)?(&TCB1):((this == &TCB2.CNTL)?(&TCB2):(&TCB3)));
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	hal_busy( HAL_BUSY_NS );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return (uint8_t)((hal_cpu_cyc() >> hal_tca_shift()) % ((uint32_t)tcb -> CCMPL +1));
+}	//End: Hal_tcb_cnt::operator uint8_t
+
+/****************************************************************************
+**  Function
+**  Hal_txdata::operator= | uint8_t
+****************************************************************************/
+//! @param data	| byte to be sent
+//! @return void |
+//! @brief USART3 writes the byte on stdout. The other USART aren't connected
+/***************************************************************************/
+
+void Hal_txdata::operator=( uint8_t data )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	if (this == &USART3.TXDATAL)
+	{
+		putchar( data );
+		CLEAR_BIT( USART3.STATUS, USART_DREIF_bp );
+		g_hal_tx_ns = g_hal_ns +hal_byte_ns();
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: Hal_txdata::operator=
+
+#endif
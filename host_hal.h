@@ -0,0 +1,518 @@
+#ifndef HOST_HAL_H
+	#define HOST_HAL_H
+
+	/**********************************************************************************
+	**	HOST HARDWARE ABSTRACTION LAYER
+	***********************************************************************************
+	**	Included by global.h in place of the avr-libc headers when the firmware is
+	**	built for the host. Defines the register blocks of the AT4809 used by the
+	**	firmware as plain variables, so init.cpp, main.cpp and int.cpp build unchanged.
+	**	ISR( vector ) defines an extern "C" function named after the vector, that a
+	**	test can call directly. host_hal.cpp simulates the peripherals that drive the
+	**	main loop, see there.
+	**
+	**		NATIVE BUILD
+	**	g++ -std=c++11 -O2 $(ls *.cpp | grep -v trace_decode) -o orangebot -pthread
+	**	./orangebot < commands > replies
+	**	USART3 reads stdin and writes stdout at the configured baud rate.
+	**	The firmware exits HAL_EXIT_TICKS system ticks after the end of stdin
+	**********************************************************************************/
+
+	/**********************************************************************************
+	**	GLOBAL INCLUDE
+	**********************************************************************************/
+
+	//type definition using the bit width and signedness
+	#include <stdint.h>
+
+	/**********************************************************************************
+	**	DEFINE
+	**********************************************************************************/
+
+		///----------------------------------------------------------------------
+		///	SIMULATION
+		///----------------------------------------------------------------------
+
+	//System ticks run after the end of stdin before the firmware exits. The link timeout plays out
+	#define HAL_EXIT_TICKS			512
+	//Simulated time spent by a read of a timer counter. A busy wait on a counter moves forward. ns
+	#define HAL_BUSY_NS				500
+	//Frequency of the RTC oscillator. Hz
+	#define HAL_RTC_HZ				32768UL
+	//Frequency of the ULP oscillator that clocks the watchdog. Hz
+	#define HAL_WDT_HZ				1024UL
+	//Exit codes of the firmware
+	#define HAL_EXIT_OK				0		//End of stdin
+	#define HAL_EXIT_WDT			2		//The watchdog expired
+	#define HAL_EXIT_HANG			3		//The main loop sleeps with no interrupt that can wake it up
+
+		///----------------------------------------------------------------------
+		///	CPU
+		///----------------------------------------------------------------------
+
+	#define CPU_I_bm					0x80
+	#define CCP_IOREG_gc				0xD8
+
+		///----------------------------------------------------------------------
+		///	PORT
+		///----------------------------------------------------------------------
+
+	#define PB6							6
+	#define PORT_ISC_gm					0x07
+	#define PORT_ISC_BOTHEDGES_gc		0x01
+
+		///----------------------------------------------------------------------
+		///	CLKCTRL
+		///----------------------------------------------------------------------
+
+	#define CLKCTRL_CLKSEL_gm			0x03
+	#define CLKCTRL_CLKSEL_gp			0
+	#define CLKCTRL_CLKOUT_bm			0x80
+	#define CLKCTRL_CLKOUT_bp			7
+	#define CLKCTRL_PEN_bm				0x01
+	#define CLKCTRL_PDIV_gm				0x1E
+	#define CLKCTRL_PDIV_gp				1
+	#define CLKCTRL_LOCKEN_bm			0x01
+	#define CLKCTRL_LOCKEN_bp			0
+	#define CLKCTRL_RUNSTDBY_bm			0x02
+	#define CLKCTRL_LOCK_bm				0x80
+
+		///----------------------------------------------------------------------
+		///	PORTMUX
+		///----------------------------------------------------------------------
+
+	#define PORTMUX_TCB0_bp				0
+	#define PORTMUX_TCB1_bp				1
+	#define PORTMUX_TCB2_bp				2
+	#define PORTMUX_TCB3_bp				3
+	#define PORTMUX_USART0_gm			0x03
+	#define PORTMUX_USART0_DEFAULT_gc	0x00
+	#define PORTMUX_USART0_ALT1_gc		0x01
+	#define PORTMUX_USART0_NONE_gc		0x03
+	#define PORTMUX_USART1_gm			0x0C
+	#define PORTMUX_USART1_DEFAULT_gc	0x00
+	#define PORTMUX_USART1_ALT1_gc		0x04
+	#define PORTMUX_USART1_NONE_gc		0x0C
+	#define PORTMUX_USART2_gm			0x30
+	#define PORTMUX_USART2_DEFAULT_gc	0x00
+	#define PORTMUX_USART2_ALT1_gc		0x10
+	#define PORTMUX_USART2_NONE_gc		0x30
+	#define PORTMUX_USART3_gm			0xC0
+	#define PORTMUX_USART3_DEFAULT_gc	0x00
+	#define PORTMUX_USART3_ALT1_gc		0x40
+	#define PORTMUX_USART3_NONE_gc		0xC0
+
+		///----------------------------------------------------------------------
+		///	RTC
+		///----------------------------------------------------------------------
+
+	#define RTC_RTCEN_bp				0
+	#define RTC_RUNSTDBY_bp				7
+	#define RTC_PRESCALER_gm			0x78
+	#define RTC_PRESCALER_gp			3
+	#define RTC_PRESCALER_DIV1_gc		(0x00 << 3)
+	#define RTC_PRESCALER_DIV2_gc		(0x01 << 3)
+	#define RTC_PRESCALER_DIV4_gc		(0x02 << 3)
+	#define RTC_PRESCALER_DIV8_gc		(0x03 << 3)
+	#define RTC_PRESCALER_DIV16_gc		(0x04 << 3)
+	#define RTC_PRESCALER_DIV32_gc		(0x05 << 3)
+	#define RTC_PRESCALER_DIV64_gc		(0x06 << 3)
+	#define RTC_PRESCALER_DIV128_gc		(0x07 << 3)
+	#define RTC_PRESCALER_DIV256_gc		(0x08 << 3)
+	#define RTC_PRESCALER_DIV512_gc		(0x09 << 3)
+	#define RTC_PRESCALER_DIV1024_gc	(0x0A << 3)
+	#define RTC_PRESCALER_DIV2048_gc	(0x0B << 3)
+	#define RTC_PRESCALER_DIV4096_gc	(0x0C << 3)
+	#define RTC_PRESCALER_DIV8192_gc	(0x0D << 3)
+	#define RTC_PRESCALER_DIV16384_gc	(0x0E << 3)
+	#define RTC_PRESCALER_DIV32768_gc	(0x0F << 3)
+	#define RTC_OVF_bp					0
+	#define RTC_CMP_bp					1
+	#define RTC_PERBUSY_bp				2
+	#define RTC_DBGRUN_bp				0
+	#define RTC_CLKSEL_gm				0x03
+	#define RTC_CLKSEL_INT32K_gc		0x00
+	#define RTC_CLKSEL_INT1K_gc			0x01
+	#define RTC_CLKSEL_TOSC32K_gc		0x02
+	#define RTC_CLKSEL_EXTCLK_gc		0x03
+	#define RTC_PITEN_bp				0
+	#define RTC_PERIOD_gm				0x78
+	#define RTC_PERIOD_gp				3
+	#define RTC_PERIOD_OFF_gc			(0x00 << 3)
+	#define RTC_PERIOD_CYC4_gc			(0x01 << 3)
+	#define RTC_PERIOD_CYC8_gc			(0x02 << 3)
+	#define RTC_PERIOD_CYC16_gc			(0x03 << 3)
+	#define RTC_PERIOD_CYC32_gc			(0x04 << 3)
+	#define RTC_PERIOD_CYC64_gc			(0x05 << 3)
+	#define RTC_PERIOD_CYC128_gc		(0x06 << 3)
+	#define RTC_PERIOD_CYC256_gc		(0x07 << 3)
+	#define RTC_PERIOD_CYC512_gc		(0x08 << 3)
+	#define RTC_PERIOD_CYC1024_gc		(0x09 << 3)
+	#define RTC_PERIOD_CYC2048_gc		(0x0A << 3)
+	#define RTC_PERIOD_CYC4096_gc		(0x0B << 3)
+	#define RTC_PERIOD_CYC8192_gc		(0x0C << 3)
+	#define RTC_PERIOD_CYC16384_gc		(0x0D << 3)
+	#define RTC_PERIOD_CYC32768_gc		(0x0E << 3)
+	#define RTC_PI_bp					0
+	#define RTC_PI_bm					0x01
+
+		///----------------------------------------------------------------------
+		///	TCA
+		///----------------------------------------------------------------------
+
+	#define TCA_SINGLE_ENABLE_bp		0
+	#define TCA_SINGLE_CLKSEL_gm		0x0E
+	#define TCA_SINGLE_CLKSEL_gp		1
+	#define TCA_SINGLE_CLKSEL_DIV1_gc	(0x00 << 1)
+	#define TCA_SINGLE_CLKSEL_DIV2_gc	(0x01 << 1)
+	#define TCA_SINGLE_CLKSEL_DIV4_gc	(0x02 << 1)
+	#define TCA_SINGLE_CLKSEL_DIV8_gc	(0x03 << 1)
+	#define TCA_SINGLE_CLKSEL_DIV16_gc	(0x04 << 1)
+	#define TCA_SINGLE_CLKSEL_DIV64_gc	(0x05 << 1)
+	#define TCA_SINGLE_CLKSEL_DIV256_gc	(0x06 << 1)
+	#define TCA_SINGLE_CLKSEL_DIV1024_gc	(0x07 << 1)
+	#define TCA_SINGLE_WGMODE_gm		0x07
+	#define TCA_SINGLE_WGMODE_NORMAL_gc	0x00
+	#define TCA_SINGLE_SPLITM_bp		0
+	#define TCA_SINGLE_CMD_gm			0x0C
+	#define TCA_SINGLE_CMD_RESTART_gc	(0x02 << 2)
+	#define TCA_SINGLE_OVF_bp			0
+	#define TCA_SINGLE_DBGRUN_bp		0
+
+		///----------------------------------------------------------------------
+		///	TCB
+		///----------------------------------------------------------------------
+
+	#define TCB_ENABLE_bp				0
+	#define TCB_CLKSEL_gm				0x06
+	#define TCB_CLKSEL_CLKDIV1_gc		(0x00 << 1)
+	#define TCB_CLKSEL_CLKDIV2_gc		(0x01 << 1)
+	#define TCB_CLKSEL_CLKTCA_gc		(0x02 << 1)
+	#define TCB_SYNCUPD_bp				4
+	#define TCB_RUNSTDBY_bp				6
+	#define TCB_CNTMODE_gm				0x07
+	#define TCB_CNTMODE_INT_gc			0x00
+	#define TCB_CNTMODE_TIMEOUT_gc		0x01
+	#define TCB_CNTMODE_CAPT_gc			0x02
+	#define TCB_CNTMODE_FRQ_gc			0x03
+	#define TCB_CNTMODE_PW_gc			0x04
+	#define TCB_CNTMODE_FRQPW_gc		0x05
+	#define TCB_CNTMODE_SINGLE_gc		0x06
+	#define TCB_CNTMODE_PWM8_gc			0x07
+	#define TCB_CCMPEN_bp				4
+	#define TCB_CCMPINIT_bp				5
+	#define TCB_ASYNC_bp				6
+	#define TCB_CAPTEI_bp				0
+	#define TCB_EDGE_bp					4
+	#define TCB_FILTER_bp				6
+	#define TCB_CAPT_bp					0
+	#define TCB_CAPT_bm					0x01
+	#define TCB_DBGRUN_bp				0
+
+		///----------------------------------------------------------------------
+		///	USART
+		///----------------------------------------------------------------------
+
+	#define USART_RXCIF_bp				7
+	#define USART_RXCIF_bm				0x80
+	#define USART_DREIF_bp				5
+	#define USART_DREIF_bm				0x20
+	#define USART_RXCIE_bp				7
+	#define USART_RXCIE_bm				0x80
+	#define USART_TXCIE_bp				6
+	#define USART_DREIE_bp				5
+	#define USART_DREIE_bm				0x20
+	#define USART_RXSIE_bp				4
+	#define USART_LBME_bp				3
+	#define USART_ABEIE_bp				2
+	#define USART_RS485_gm				0x03
+	#define USART_RS485_OFF_gc			0x00
+	#define USART_RS485_EXT_gc			0x01
+	#define USART_RS485_INT_gc			0x02
+	#define USART_RXEN_bp				7
+	#define USART_TXEN_bp				6
+	#define USART_SFDEN_bp				4
+	#define USART_ODME_bp				3
+	#define USART_RXMODE_gm				0x06
+	#define USART_RXMODE_NORMAL_gc		(0x00 << 1)
+	#define USART_RXMODE_CLK2X_gc		(0x01 << 1)
+	#define USART_RXMODE_GENAUTO_gc		(0x02 << 1)
+	#define USART_RXMODE_LINAUTO_gc		(0x03 << 1)
+	#define USART_MPCM_bp				0
+	#define USART_CMODE_gm				0xC0
+	#define USART_CMODE_ASYNCHRONOUS_gc	(0x00 << 6)
+	#define USART_CMODE_SYNCHRONOUS_gc	(0x01 << 6)
+	#define USART_CMODE_IRCOM_gc		(0x02 << 6)
+	#define USART_CMODE_MSPI_gc			(0x03 << 6)
+	#define USART_PMODE_gm				0x30
+	#define USART_PMODE_DISABLED_gc		(0x00 << 4)
+	#define USART_PMODE_EVEN_gc			(0x02 << 4)
+	#define USART_PMODE_ODD_gc			(0x03 << 4)
+	#define USART_SBMODE_bp				3
+	#define USART_CHSIZE_gm				0x07
+	#define USART_CHSIZE_5BIT_gc		0x00
+	#define USART_CHSIZE_6BIT_gc		0x01
+	#define USART_CHSIZE_7BIT_gc		0x02
+	#define USART_CHSIZE_8BIT_gc		0x03
+	#define USART_CHSIZE_9BITL_gc		0x06
+	#define USART_CHSIZE_9BITH_gc		0x07
+	#define USART_UDORD_bp				2
+	#define USART_UCPHA_bp				1
+	#define USART_IREI_bp				0
+	#define USART_DBGRUN_bp				0
+
+		///----------------------------------------------------------------------
+		///	SLPCTRL, WDT, RSTCTRL
+		///----------------------------------------------------------------------
+
+	#define SLPCTRL_SEN_bp				0
+	#define SLPCTRL_SMODE_gm			0x06
+	#define SLPCTRL_SMODE_IDLE_gc		(0x00 << 1)
+	#define SLPCTRL_SMODE_STDBY_gc		(0x01 << 1)
+	#define SLPCTRL_SMODE_PDOWN_gc		(0x02 << 1)
+	#define WDT_PERIOD_gm				0x0F
+	#define WDT_PERIOD_OFF_gc			0x00
+	#define WDT_PERIOD_128CLK_gc		0x05
+	#define WDT_WINDOW_gm				0xF0
+	#define RSTCTRL_PORF_bm				0x01
+	#define RSTCTRL_WDRF_bp				3
+
+		///----------------------------------------------------------------------
+		///	ADC, VREF
+		///----------------------------------------------------------------------
+
+	#define ADC_ENABLE_bp				0
+	#define ADC_ENABLE_bm				0x01
+	#define ADC_FREERUN_bp				1
+	#define ADC_FREERUN_bm				0x02
+	#define ADC_RESSEL_bp				2
+	#define ADC_SAMPNUM_gm				0x07
+	#define ADC_SAMPNUM_ACC8_gc			0x03
+	#define ADC_SAMPCAP_bp				6
+	#define ADC_REFSEL_gm				0x30
+	#define ADC_REFSEL_INTREF_gc		(0x00 << 4)
+	#define ADC_PRESC_gm				0x07
+	#define ADC_PRESC_DIV8_gc			0x02
+	#define ADC_PRESC_DIV16_gc			0x03
+	#define ADC_PRESC_DIV32_gc			0x04
+	#define ADC_MUXPOS_gm				0x1F
+	#define ADC_MUXPOS_AIN0_gc			0x00
+	#define ADC_STCONV_bm				0x01
+	#define ADC_RESRDY_bm				0x01
+	#define VREF_ADC0REFSEL_gm			0x70
+	#define VREF_ADC0REFSEL_2V5_gc		(0x02 << 4)
+
+	/**********************************************************************************
+	**	MACRO
+	**********************************************************************************/
+
+	//Define an interrupt service routine. A plain function that tests can call
+	#define ISR( vector )	\
+		extern "C" void vector( void ); extern "C" void vector( void )
+
+	//Global interrupt enable
+	#define sei()	\
+		(SREG |= CPU_I_bm)
+
+	//Global interrupt disable
+	#define cli()	\
+		(SREG &= (uint8_t)~CPU_I_bm)
+
+	//Busy wait. Moves the simulated time
+	#define _delay_us( us )	\
+		hal_busy( (uint32_t)(us) *1000UL )
+
+	#define _delay_ms( ms )	\
+		hal_busy( (uint32_t)(ms) *1000000UL )
+
+	//Feed the watchdog
+	#define wdt_reset()	\
+		hal_wdt_reset()
+
+	//Sleep until the next simulated interrupt
+	#define sleep_cpu()	\
+		hal_sleep()
+
+	/**********************************************************************************
+	**	TYPEDEF
+	**********************************************************************************/
+
+	typedef volatile uint8_t register8_t;
+	typedef volatile uint16_t register16_t;
+
+	//The values of the enumerated groups used with a cast
+	typedef enum { CLKCTRL_CLKSEL_OSC20M_gc = 0x00 } CLKCTRL_CLKSEL_t;
+	typedef enum { CLKCTRL_PDIV_2X_gc = (0x00 << 1) } CLKCTRL_PDIV_t;
+
+	/**********************************************************************************
+	**	PROTOTYPE: STRUCTURE
+	**********************************************************************************/
+
+	//Counter of a timer type B. A read returns the count at the simulated time and moves the time forward
+	class Hal_tcb_cnt
+	{
+		public:
+			operator uint8_t( void ) const;
+		private:
+			uint8_t g_value;
+	};
+
+	//Transmit data register of a USART. A write sends the byte
+	class Hal_txdata
+	{
+		public:
+			void operator=( uint8_t data );
+		private:
+			uint8_t g_value;
+	};
+
+	typedef struct
+	{
+		register8_t DIR, DIRSET, DIRCLR, DIRTGL, OUT, OUTSET, OUTCLR, OUTTGL, IN, INTFLAGS, PORTCTRL, reserved[5];
+		register8_t PIN0CTRL, PIN1CTRL, PIN2CTRL, PIN3CTRL, PIN4CTRL, PIN5CTRL, PIN6CTRL, PIN7CTRL;
+	} PORT_t;
+
+	typedef struct
+	{
+		register8_t CTRLA, CTRLB, CTRLC, CTRLD, CTRLECLR, CTRLESET, CTRLFCLR, CTRLFSET, EVCTRL, INTCTRL, INTFLAGS, reserved0[2], DBGCTRL, TEMP, reserved1[17];
+		register16_t CNT;
+		register8_t reserved2[4];
+		register16_t PER, CMP0, CMP1, CMP2;
+		register8_t reserved3[8];
+		register16_t PERBUF, CMP0BUF, CMP1BUF, CMP2BUF;
+	} TCA_SINGLE_t;
+
+	typedef union
+	{
+		TCA_SINGLE_t SINGLE;
+	} TCA_t;
+
+	typedef struct
+	{
+		register8_t CTRLA, CTRLB, reserved0[2], EVCTRL, INTCTRL, INTFLAGS, STATUS, DBGCTRL, TEMP;
+		union
+		{
+			register16_t CNT;
+			struct
+			{
+				Hal_tcb_cnt CNTL;
+				register8_t CNTH;
+			};
+		};
+		union
+		{
+			register16_t CCMP;
+			struct
+			{
+				register8_t CCMPL;
+				register8_t CCMPH;
+			};
+		};
+	} TCB_t;
+
+	typedef struct
+	{
+		register8_t RXDATAL, RXDATAH;
+		Hal_txdata TXDATAL;
+		register8_t TXDATAH, STATUS, CTRLA, CTRLB, CTRLC;
+		register16_t BAUD;
+		register8_t CTRLD, DBGCTRL, EVCTRL, TXPLCTRL, RXPLCTRL;
+	} USART_t;
+
+	typedef struct
+	{
+		register8_t CTRLA, STATUS, INTCTRL, INTFLAGS, TEMP, DBGCTRL, CALIB, CLKSEL;
+		register16_t CNT, PER, CMP;
+		register8_t reserved1[2], PITCTRLA, PITSTATUS, PITINTCTRL, PITINTFLAGS, reserved2, PITDBGCTRL;
+	} RTC_t;
+
+	typedef struct
+	{
+		register8_t MCLKCTRLA, MCLKCTRLB, MCLKLOCK, MCLKSTATUS, reserved0[12], OSC20MCTRLA, OSC20MCALIBA, OSC20MCALIBB;
+	} CLKCTRL_t;
+
+	typedef struct
+	{
+		register8_t EVSYSROUTEA, CCLROUTEA, USARTROUTEA, TWISPIROUTEA, TCAROUTEA, TCBROUTEA;
+	} PORTMUX_t;
+
+	typedef struct
+	{
+		register8_t CTRLA;
+	} SLPCTRL_t;
+
+	typedef struct
+	{
+		register8_t CTRLA, STATUS;
+	} WDT_t;
+
+	typedef struct
+	{
+		register8_t RSTFR, SWRR;
+	} RSTCTRL_t;
+
+	typedef struct
+	{
+		register8_t CTRLA, CTRLB, CTRLC, CTRLD, CTRLE, SAMPCTRL, MUXPOS, reserved0, COMMAND, EVCTRL, INTCTRL, INTFLAGS, DBGCTRL, TEMP;
+		register16_t RES, WINLT, WINHT;
+	} ADC_t;
+
+	typedef struct
+	{
+		register8_t CTRLA, CTRLB;
+	} VREF_t;
+
+	/**********************************************************************************
+	**	PROTOTYPE: GLOBAL VARIABILE
+	**********************************************************************************/
+
+	//Register blocks
+	extern register8_t SREG;
+	extern register8_t CCP;
+	extern PORT_t PORTA, PORTB, PORTC, PORTD, PORTE, PORTF;
+	extern TCA_t TCA0;
+	extern TCB_t TCB0, TCB1, TCB2, TCB3;
+	extern USART_t USART0, USART1, USART2, USART3;
+	extern RTC_t RTC;
+	extern CLKCTRL_t CLKCTRL;
+	extern PORTMUX_t PORTMUX;
+	extern SLPCTRL_t SLPCTRL;
+	extern WDT_t WDT;
+	extern RSTCTRL_t RSTCTRL;
+	extern ADC_t ADC0;
+	extern VREF_t VREF;
+	//avr-libc defines the ports as macros. at4809_port.h tests them
+	#define PORTA PORTA
+	#define PORTB PORTB
+	#define PORTC PORTC
+	#define PORTD PORTD
+	#define PORTE PORTE
+	#define PORTF PORTF
+
+	//Simulated time since reset. ns
+	extern uint64_t g_hal_ns;
+	//Result of the ADC for each MUXPOS channel. Set by tests to simulate the current sense
+	extern uint16_t g_hal_adc[ 16 ];
+
+	/**********************************************************************************
+	**	PROTOTYPE: FUNCTION
+	**********************************************************************************/
+
+	//Interrupt vectors of the firmware. Callable by tests
+	extern "C" void RTC_PIT_vect( void );
+	extern "C" void PORTC_PORT_vect( void );
+	extern "C" void USART3_RXC_vect( void );
+	extern "C" void USART3_DRE_vect( void );
+	extern "C" void ADC0_RESRDY_vect( void );
+	extern "C" void TCB0_INT_vect( void );
+
+	//Move the simulated time forward without serving interrupts
+	extern void hal_busy( uint32_t ns );
+	//Sleep until the next simulated interrupt and serve it
+	extern void hal_sleep( void );
+	//Feed the watchdog
+	extern void hal_wdt_reset( void );
+
+#else
+	#warning "multiple inclusion of the header file"
+#endif
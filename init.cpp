@@ -26,14 +26,20 @@ extern void init_clock( void );
 extern void init_pin( void );
 //Initialize RTC timer as periodic interrupt
 extern void init_rtc( void );
+//Initialize the sleep controller
+extern void init_sleep( void );
 //Initialize timer type A. AT4809 has a single of such timers.
-extern void init_timer0a_split( void );
+extern void init_timer0a( void );
 //setup one of four timers type B of the AT4809 as PWM generator
 extern void init_timer_b( TCB_t &timer );
 //Initialize one of four USART transceivers
 extern void init_uart( USART_t &usart );
 //Initialize port multiplexer for alternate functions
 extern void init_mux( void );
+//Initialize the ADC as free running scanner of the motor current sense
+extern void init_adc( void );
+//Initialize the watchdog timer
+extern void init_wdt( void );
 
 
 
@@ -76,19 +82,30 @@ void init(void)
 	
 	//Initialize RTC timer as Periodic interrupt source: RTC_PIT_vect
 	init_rtc();
+
+	//Initialize the sleep controller. The main loop sleeps when it has nothing to do
+	init_sleep();
 	
-	//Initialize timer type A
-	init_timer0a_split();
+	//Initialize timer type A as 16bit free running counter. Clocks the timers type B, times the scheduler tasks and the profiler
+	init_timer0a();
 	
 	//Initialize four timers type B as 20KHz 8bit PWM generators for the VNH7040 Motor drivers
 	init_timer_b( TCB0 );
 	init_timer_b( TCB1 );
 	init_timer_b( TCB2 );
 	init_timer_b( TCB3 );
+	//Restart TCA0. SYNCUPD restarts the timers type B with it, from here on they count CLK_TCA in phase
+	TCA0.SINGLE.CTRLESET = TCA_SINGLE_CMD_RESTART_gc;
 
 	//Initialize USART 3 as async UART 256.4Kb/s
 	init_uart( USART3 );
 
+	//Initialize the ADC as free running scanner of the VNH7040 current sense
+	init_adc();
+
+	//Initialize the watchdog. From now on the main loop must feed it. See watchdog.cpp
+	init_wdt();
+
 	//Activate interrupts
 	sei();
 
@@ -208,7 +225,7 @@ void init_pin( void )
 	//!	PC7				: ENC3_CHB
 	//----------------------------------------------------------------
 	//				0		1		2		3		4		5		6		7
-	PORT_C_CONFIG(	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z );
+	PORT_C_CONFIG(	PIN_IE,	PIN_IE,	PIN_IE,	PIN_IE,	PIN_IE,	PIN_IE,	PIN_IE,	PIN_IE );
 
 	//----------------------------------------------------------------
 	//!	PORTD
@@ -222,7 +239,7 @@ void init_pin( void )
 	//!	PD7				: DRV3_CTRLB
 	//----------------------------------------------------------------
 	//				0		1		2		3		4		5		6		7
-	PORT_D_CONFIG(	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z,	PIN_Z,	PIN_L,	PIN_L );
+	PORT_D_CONFIG(	PIN_A,	PIN_A,	PIN_A,	PIN_A,	PIN_Z,	PIN_Z,	PIN_L,	PIN_L );
 
 	//----------------------------------------------------------------
 	//!	PORTE
@@ -458,7 +475,8 @@ void init_rtc( void )
 
 	//Wait for the ***
 	//while (IS_BIT_ONE(RTC.STATUS, RTC_PERBUSY_bp));
-	RTC.PER = (uint16_t)0;
+	//RTC counter free runs over the full 16bit range. Timebase of the tick statistics
+	RTC.PER = (uint16_t)0xffff;
 	//Compare register for compare interrupt
 	RTC.CMP = (uint16_t)0;
 
@@ -478,53 +496,89 @@ void init_rtc( void )
 
 /****************************************************************************
 **  Function
-**  init_timer_a |
+**  init_sleep |
 ****************************************************************************/
-//! @brief initialize timer type a in split mode as two 8bit timers with six compare channels
+//! @brief Initialize the sleep controller
+//! @details Sleep is enabled, the SLEEP instruction puts the CPU in IDLE mode.
+//!	In IDLE mode only the CPU clock is stopped, peripherals keep running
+//!	and any interrupt wakes up the CPU within a few clock cycles
+/***************************************************************************/
+
+void init_sleep( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//! Fetch registers
+	uint8_t ctrla_tmp = SLPCTRL.CTRLA;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//! Sleep mode. Activate only one
+	SET_MASKED_BIT( ctrla_tmp, SLPCTRL_SMODE_gm, SLPCTRL_SMODE_IDLE_gc );
+	//SET_MASKED_BIT( ctrla_tmp, SLPCTRL_SMODE_gm, SLPCTRL_SMODE_STDBY_gc );
+	//SET_MASKED_BIT( ctrla_tmp, SLPCTRL_SMODE_gm, SLPCTRL_SMODE_PDOWN_gc );
+
+	//! Enable the SLEEP instruction
+	SET_BIT( ctrla_tmp, SLPCTRL_SEN_bp );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	//! Registers write back
+	SLPCTRL.CTRLA = ctrla_tmp;
+
+	return;
+}	//End: init_sleep
+
+/****************************************************************************
+**  Function
+**  init_timer0a |
+****************************************************************************/
+//! @brief initialize timer type a as a 16bit free running counter
 //! @details setup the only timer type A of the AT4809
 //!
-//!	Clock from event control is disabled in SPLIT mode
+//!	TCA0 clocks the four timers type B PWM generators through CLK_TCA
+//!	and is the timebase of the scheduler statistics and of the section profiler.
+//!	The prescaler is chosen by the PWM carrier solver, see PWM_CARRIER_HZ.
+//!	Default 20MHz /4 = 5MHz. One count is 200ns, 4 CPU cycles. The counter wraps every 13.1ms
 //!
 //! Interrupt vectors available:
-//! TCA0_LUNF_vect
 //! TCA0_OVF_vect
-//! TCA0_HUNF_vect
-//! TCA0_LCMP0_vect
 //! TCA0_CMP0_vect
 //! TCA0_CMP1_vect
-//! TCA0_LCMP1_vect
-//! TCA0_LCMP2_vect
 //! TCA0_CMP2_vect
 /***************************************************************************/
 
-void init_timer0a_split( void )
+void init_timer0a( void )
 {
 	//----------------------------------------------------------------
 	//	VARS
 	//----------------------------------------------------------------
 
 	//Load temporary registers
-	uint8_t ctrla_tmp			= TCA0.SPLIT.CTRLA;
-	uint8_t ctrlb_tmp			= TCA0.SPLIT.CTRLB;
-	uint8_t ctrlc_tmp			= TCA0.SPLIT.CTRLC;
-	uint8_t ctrld_tmp			= TCA0.SPLIT.CTRLD;
-	uint8_t ctrle_tmp			= TCA0.SPLIT.CTRLESET;
-	uint8_t dbgctrl_tmp			= TCA0.SPLIT.DBGCTRL;
-	uint8_t port_mux_tca0_tmp	= PORTMUX.TCAROUTEA;
-	uint8_t intctrl_tmp			= TCA0.SPLIT.INTCTRL;
+	uint8_t ctrla_tmp			= TCA0.SINGLE.CTRLA;
+	uint8_t ctrlb_tmp			= TCA0.SINGLE.CTRLB;
+	uint8_t ctrld_tmp			= TCA0.SINGLE.CTRLD;
+	uint8_t dbgctrl_tmp			= TCA0.SINGLE.DBGCTRL;
+	uint8_t intctrl_tmp			= TCA0.SINGLE.INTCTRL;
 
 	//----------------------------------------------------------------
 	//	INIT
 	//----------------------------------------------------------------
 
 		//----------------------------------------------------------------
-		//! Enable Split Mode
+		//! Disable Split Mode
 		//----------------------------------------------------------------
 		//	Function of registers change according to the mode.
 		//	0 = 3x 16bit
 		//	1 = 6x 8bit
 
-	SET_BIT( ctrld_tmp, TCA_SPLIT_SPLITM_bp );
+	CLEAR_BIT( ctrld_tmp, TCA_SINGLE_SPLITM_bp );
 
 		//----------------------------------------------------------------
 		//! Enable TCA
@@ -532,71 +586,44 @@ void init_timer0a_split( void )
 		//	0 = disabled
 		//	1 = enabled
 
-	SET_BIT( ctrla_tmp, TCA_SPLIT_ENABLE_bp );
+	SET_BIT( ctrla_tmp, TCA_SINGLE_ENABLE_bp );
 
 		//----------------------------------------------------------------
 		//! TCA Clock Prescaler
 		//----------------------------------------------------------------
 		//	Set the clock prescaler of this TCA. Activate only one value
-
-	//SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV1_gc );
-	//SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV2_gc );
-	SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV4_gc );
-	//SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV8_gc );
-	//SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV16_gc );
-	//SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV64_gc );
-	//SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV256_gc );
-	//SET_MASKED_BIT( ctrla_tmp, TCA_SPLIT_CLKSEL_gm , TCA_SPLIT_CLKSEL_DIV1024_gc );
-
-		//----------------------------------------------------------------
-		//! TCA Enable compare output and waveform output pin override for each compare channel
-		//----------------------------------------------------------------
-
-	//SET_BIT( ctrlb_tmp, TCA_SPLIT_LCMP0EN_bp );
-	//SET_BIT( ctrlb_tmp, TCA_SPLIT_LCMP1EN_bp );
-	//SET_BIT( ctrlb_tmp, TCA_SPLIT_LCMP2EN_bp );
-	//SET_BIT( ctrlb_tmp, TCA_SPLIT_HCMP0EN_bp );
-	//SET_BIT( ctrlb_tmp, TCA_SPLIT_HCMP1EN_bp );
-	//SET_BIT( ctrlb_tmp, TCA_SPLIT_HCMP2EN_bp );
+		//	CLK_TCA also clocks the timers type B. Changing it changes the PWM frequency
+		//	The PWM carrier solver picks it from PWM_CARRIER_HZ
+
+	SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , pwm_tca_clksel[PWM_TCA_INDEX] );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV1_gc );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV2_gc );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV4_gc );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV8_gc );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV16_gc );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV64_gc );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV256_gc );
+	//SET_MASKED_BIT( ctrla_tmp, TCA_SINGLE_CLKSEL_gm , TCA_SINGLE_CLKSEL_DIV1024_gc );
 
 		//----------------------------------------------------------------
-		//! TCA Enable timer commands
+		//! TCA Waveform generation mode
 		//----------------------------------------------------------------
+		//	Normal mode. The counter runs from 0 to PER and wraps. No waveform outputs
 
-	//Disable force commands
-	SET_MASKED_BIT( ctrle_tmp, (uint8_t)0x03 , (uint8_t)0x00 );
-	//ENABLE force commands for both channels
-	//SET_MASKED_BIT( ctrle_tmp, (uint8_t)0x03 , (uint8_t)0x03 );
+	SET_MASKED_BIT( ctrlb_tmp, TCA_SINGLE_WGMODE_gm, TCA_SINGLE_WGMODE_NORMAL_gc );
 
 		//----------------------------------------------------------------
 		//! ENABLE TCA interrupts
 		//----------------------------------------------------------------
 
-	//Underflow of low counter
-	//SET_BIT( intctrl_tmp, TCA_SPLIT_LUNF_bp );
-	//Underflow of high counter
-	//SET_BIT( intctrl_tmp, TCA_SPLIT_HUNF_bp );
-	//Compare channel
-	//SET_BIT( intctrl_tmp, TCA_SPLIT_LCMP0_bp );
-	//SET_BIT( intctrl_tmp, TCA_SPLIT_LCMP1_bp );
-	//SET_BIT( intctrl_tmp, TCA_SPLIT_LCMP2_bp );
+	//Overflow
+	//SET_BIT( intctrl_tmp, TCA_SINGLE_OVF_bp );
 
 		//----------------------------------------------------------------
 		//! ENABLE TCA debug
 		//----------------------------------------------------------------
 
-	SET_BIT( dbgctrl_tmp, TCA_SPLIT_DBGRUN_bp );
-
-		//----------------------------------------------------------------
-		//! Set TCA waveform outputs to a given port. You can activate only one port
-		//----------------------------------------------------------------
-
-	//SET_MASKED_BIT( port_mux_tca0_tmp, PORTMUX_TCA0_gm, PORTMUX_TCA0_PORTA_gc );	//default
-	SET_MASKED_BIT( port_mux_tca0_tmp, PORTMUX_TCA0_gm, PORTMUX_TCA0_PORTB_gc );
-	//SET_MASKED_BIT( port_mux_tca0_tmp, PORTMUX_TCA0_gm, PORTMUX_TCA0_PORTC_gc );
-	//SET_MASKED_BIT( port_mux_tca0_tmp, PORTMUX_TCA0_gm, PORTMUX_TCA0_PORTD_gc );
-	//SET_MASKED_BIT( port_mux_tca0_tmp, PORTMUX_TCA0_gm, PORTMUX_TCA0_PORTE_gc );
-	//SET_MASKED_BIT( port_mux_tca0_tmp, PORTMUX_TCA0_gm, PORTMUX_TCA0_PORTF_gc );
+	SET_BIT( dbgctrl_tmp, TCA_SINGLE_DBGRUN_bp );
 
 	//----------------------------------------------------------------
 	//	RETURN
@@ -604,30 +631,17 @@ void init_timer0a_split( void )
 
 	//! Register write back.
 	//Write back control registers
-	TCA0.SPLIT.CTRLB = ctrlb_tmp;
-	TCA0.SPLIT.CTRLC = ctrlc_tmp;
-	TCA0.SPLIT.CTRLD = ctrld_tmp;
-	TCA0.SPLIT.CTRLESET = ctrle_tmp;
-	TCA0.SPLIT.DBGCTRL = dbgctrl_tmp;
-	//Write back output waveform port selector
-	PORTMUX.TCAROUTEA = port_mux_tca0_tmp;
-
-	//Period registers for the High and Low 8bit counters
-	TCA0.SPLIT.LPER = (uint8_t)255;
-	TCA0.SPLIT.HPER = (uint8_t)255;
-	//Initial PWM settings for channels L0 to L2
-	TCA0.SPLIT.LCMP0 = (uint8_t)0x00;
-	TCA0.SPLIT.LCMP1 = (uint8_t)0x00;
-	TCA0.SPLIT.LCMP2 = (uint8_t)0x00;
-	//Initial PWM settings for channels H0 to H2
-	TCA0.SPLIT.HCMP0 = (uint8_t)0x00;
-	TCA0.SPLIT.HCMP1 = (uint8_t)0x00;
-	TCA0.SPLIT.HCMP2 = (uint8_t)0x0;
+	TCA0.SINGLE.CTRLB = ctrlb_tmp;
+	TCA0.SINGLE.CTRLD = ctrld_tmp;
+	TCA0.SINGLE.DBGCTRL = dbgctrl_tmp;
+
+	//Free run over the full 16bit range
+	TCA0.SINGLE.PER = (uint16_t)0xffff;
 
 	//Write back control A for last as it's the one that sets the clock and starts the timer
-	TCA0.SPLIT.CTRLA = ctrla_tmp;
+	TCA0.SINGLE.CTRLA = ctrla_tmp;
 	//Write back interrupt enable
-	TCA0.SPLIT.INTCTRL = intctrl_tmp;
+	TCA0.SINGLE.INTCTRL = intctrl_tmp;
 
 	return;
 }	//End: init_timer0a
@@ -718,10 +732,10 @@ void init_timer_b( TCB_t &timer )
 	//	WRITE BACK
 	//----------------------------------------------------------------
 	
-	//TOP in PWM 8-bit mode
-	timer.CCMPL = 255;
-	//PWM in PWM 8bit mode
-	timer.CCMPH = 127;
+	//TOP in PWM 8-bit mode. Chosen by the PWM carrier solver
+	timer.CCMPL = PWM_TOP;
+	//PWM in PWM 8bit mode. Motors are stopped until init_motors
+	timer.CCMPH = 0;
 	
 	timer.CTRLB = ctrlb_tmp;
 	timer.EVCTRL = evctrl_tmp;
@@ -910,3 +924,115 @@ void init_uart( USART_t &usart )
 
 	return;
 }	//End: init_uart
+
+/****************************************************************************
+**  Function
+**  init_adc |
+****************************************************************************/
+//! @brief Initialize the ADC as free running scanner of the motor current sense
+//! @details ADC0 converts AIN0..3, the MultiSense outputs of DRV0..3.
+//!	VREF 2.5V. CLK_ADC = 20MHz /16 = 1.25MHz. 10bit conversion in 15 CLK_ADC, 12us.
+//!	Each result accumulates 8 conversions in hardware, about 100us.
+//!	Free running, the ADC ISR picks the results and scans the channels. See current.cpp
+//!	init_current must have been called before
+//!
+//! Interrupt vectors available:
+//! ADC0_RESRDY_vect
+//! ADC0_WCOMP_vect
+/***************************************************************************/
+
+void init_adc( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//Load temporary registers
+	uint8_t ctrla_tmp	= ADC0.CTRLA;
+	uint8_t ctrlb_tmp	= ADC0.CTRLB;
+	uint8_t ctrlc_tmp	= ADC0.CTRLC;
+	uint8_t vref_tmp	= VREF.CTRLA;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+		//----------------------------------------------------------------
+		//! Voltage reference
+		//----------------------------------------------------------------
+		//	Internal reference. Reference above 1V wants the reduced sample capacitor
+
+	SET_MASKED_BIT( vref_tmp, VREF_ADC0REFSEL_gm, VREF_ADC0REFSEL_2V5_gc );
+	SET_MASKED_BIT( ctrlc_tmp, ADC_REFSEL_gm, ADC_REFSEL_INTREF_gc );
+	SET_BIT( ctrlc_tmp, ADC_SAMPCAP_bp );
+
+		//----------------------------------------------------------------
+		//! ADC Clock Prescaler
+		//----------------------------------------------------------------
+		//	CLK_ADC must stay under 1.5MHz for the full 10bit resolution. Activate only one value
+
+	//SET_MASKED_BIT( ctrlc_tmp, ADC_PRESC_gm, ADC_PRESC_DIV8_gc );
+	SET_MASKED_BIT( ctrlc_tmp, ADC_PRESC_gm, ADC_PRESC_DIV16_gc );
+	//SET_MASKED_BIT( ctrlc_tmp, ADC_PRESC_gm, ADC_PRESC_DIV32_gc );
+
+		//----------------------------------------------------------------
+		//! Hardware accumulation
+		//----------------------------------------------------------------
+		//	Number of conversions summed into a result. 8 x 10bit fit 13bit
+
+	SET_MASKED_BIT( ctrlb_tmp, ADC_SAMPNUM_gm, ADC_SAMPNUM_ACC8_gc );
+
+		//----------------------------------------------------------------
+		//! Mode
+		//----------------------------------------------------------------
+		//	10bit, free running. A new conversion starts as soon as the previous one is done
+
+	CLEAR_BIT( ctrla_tmp, ADC_RESSEL_bp );
+	SET_BIT( ctrla_tmp, ADC_FREERUN_bp );
+	SET_BIT( ctrla_tmp, ADC_ENABLE_bp );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	//! Register write back.
+	VREF.CTRLA = vref_tmp;
+	ADC0.CTRLB = ctrlb_tmp;
+	ADC0.CTRLC = ctrlc_tmp;
+	//First channel
+	ADC0.MUXPOS = ADC_MUXPOS_AIN0_gc;
+	//Result ready interrupt
+	ADC0.INTCTRL = ADC_RESRDY_bm;
+	//Write back control A for last as it's the one that enables the ADC
+	ADC0.CTRLA = ctrla_tmp;
+	//Start the first conversion. Free running does the rest
+	ADC0.COMMAND = ADC_STCONV_bm;
+
+	return;
+}	//End: init_adc
+
+/****************************************************************************
+**  Function
+**  init_wdt |
+****************************************************************************/
+//! @brief Initialize the watchdog timer
+//! @details Normal mode, no window. The WDT runs from the 1KHz ULP oscillator
+//!	and resets the AT4809 if it isn't fed for WDT_PERIOD. watchdog_service feeds it.
+//!	CTRLA is protected by the CCP
+/***************************************************************************/
+
+void init_wdt( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//! Period. No window
+	INIT_CONFIG_PROTECTED( WDT.CTRLA, WDT_PERIOD_gm | WDT_WINDOW_gm, 0, WDT_PERIOD );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_wdt
@@ -22,6 +22,9 @@ ISR( RTC_PIT_vect )
 	//	VARS
 	//----------------------------------------------------------------
 
+	//The main loop may be halfway through a 16bit read of TCA0. Its high byte waits in TEMP
+	uint8_t temp_tmp = TCA0.SINGLE.TEMP;
+
 	//----------------------------------------------------------------
 	//	INIT
 	//----------------------------------------------------------------
@@ -30,8 +33,12 @@ ISR( RTC_PIT_vect )
 	//	BODY
 	//----------------------------------------------------------------	
 	
-	//Set the System Tick
-	g_isr_flags.system_tick = true;
+	//Timestamps of the tick for the scheduler statistics
+	g_tick_timestamp = RTC.CNT;
+	g_tick_tca = TCA0.SINGLE.CNT;
+	TCA0.SINGLE.TEMP = temp_tmp;
+	//Count the System Tick. The main loop tells how many ticks it's late by
+	g_isr_flags.tick_cnt++;
 	
 	//----------------------------------------------------------------
 	//	RETURN
@@ -42,35 +49,118 @@ ISR( RTC_PIT_vect )
 }
 
 /****************************************************************************
-**	USART3 RX Interrupt
+**	PORTC Pin Change Interrupt
 *****************************************************************************
-**	
+**	Quadrature encoders. Both edges of both channels of the four encoders
 ****************************************************************************/
 
-ISR( USART3_RXC_vect )
+ISR( PORTC_PORT_vect )
 {
 	//----------------------------------------------------------------
 	//	VARS
 	//----------------------------------------------------------------
-	
-	//Temp var
-	uint8_t rx_data_tmp;
-	
+
+	//Sample the pins as close as possible to the edge
+	uint8_t pins = PORTC.IN;
+
 	//----------------------------------------------------------------
-	//	INIT
+	//	BODY
 	//----------------------------------------------------------------
-	
+
+	//Decode the four encoders
+	encoder_isr( pins );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	//Manually clear the interrupt flags
+	PORTC.INTFLAGS = (uint8_t)0xff;
+}
+
+/****************************************************************************
+**	USART3 RX Interrupt
+*****************************************************************************
+**	RPI port
+****************************************************************************/
+
+ISR( USART3_RXC_vect )
+{
 	//----------------------------------------------------------------
 	//	BODY
 	//----------------------------------------------------------------
 	
-	//Fetch the data and clear the interrupt flag
-	rx_data_tmp = USART3.RXDATAL;
-	//Push byte into RS485 buffer for processing
-	AT_BUF_PUSH_SAFER( rpi_rx_buf, rx_data_tmp );
+	//Fetch the data, clear the interrupt flag and push the byte into the RX buffer of the port
+	uart_port_rx_isr( g_uart_port[UART_PORT_RPI] );
 	
 	//----------------------------------------------------------------
 	//	RETURN
 	//----------------------------------------------------------------	
 	
 }
+
+/****************************************************************************
+**	USART3 Data Register Empty Interrupt
+*****************************************************************************
+**	RPI port. Only used to wake up the main loop from sleep
+****************************************************************************/
+
+ISR( USART3_DRE_vect )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Disarm the interrupt. The main loop moves the next byte
+	uart_port_dre_isr( g_uart_port[UART_PORT_RPI] );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+}
+
+/****************************************************************************
+**	ADC0 Result Ready Interrupt
+*****************************************************************************
+**	Motor current sense. Free running scan of AIN0..3
+****************************************************************************/
+
+ISR( ADC0_RESRDY_vect )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Fetch the result, which clears the interrupt flag, and scan the next channel
+	adc_isr();
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+}
+
+/****************************************************************************
+**	TCB0 Capture Interrupt
+*****************************************************************************
+**	End of a PWM period. Dither of the duty fraction of the drivers
+**	Only enabled by apply_vnh7040 while a duty has a fraction
+****************************************************************************/
+
+ISR( TCB0_INT_vect )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Integer part of the next period of each driver
+	pwm_dither_isr();
+	//Clear interrupt flag
+	TCB0.INTFLAGS = TCB_CAPT_bm;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+}
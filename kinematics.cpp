@@ -0,0 +1,346 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	KINEMATICS
+*****************************************************************
+**	Differential drive kinematics of the platform.
+**	The RPI commands a linear and an angular velocity, the
+**	firmware mixes them into the speed of the two sides and maps
+**	the sides on the motors.
+**
+**		LAYOUT
+**	Numeration is handled like an IC with dot on the back, viewing from the top
+**			Left	Right
+**	Front	2		1
+**	Rear	3		0
+**	Direction of each motor that moves the platform forward is
+**	speed_ctrl_fwd_dir
+**
+**		MIXING
+**	linear	: mm/s, forward positive
+**	angular	: mrad/s, counterclockwise positive viewing from the top
+**	right	= linear +angular *track /2000
+**	left	= linear -angular *track /2000
+**	CURVATURE LIMIT: if enabled, |angular| is clipped to
+**	max_curvature *|linear| /1000. max_curvature is in mrad/m
+**	SATURATION: if a side exceeds max_speed, both sides are scaled
+**	by the same factor. The ratio of the sides, therefore the
+**	radius of the turn, is preserved.
+**	Open loop commands map max_speed to DC_MOTOR_MAX_DUTY
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Geometry and limits of the platform
+Kinematics kinematics;
+
+//Side of each motor. true = right side
+const bool kinematics_f_right[DC_MOTOR_NUM] = { true, true, false, false };
+
+/****************************************************************************
+**  Function
+**  init_kinematics
+****************************************************************************/
+//! @return void |
+//! @brief Load the default geometry and limits of the platform
+//! @details Curvature limit starts disabled
+/***************************************************************************/
+
+void init_kinematics( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	kinematics.track = PLATFORM_TRACK_WIDTH;
+	kinematics.max_speed = PLATFORM_MAX_SPEED;
+	kinematics.max_curvature = 0;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_kinematics
+
+/****************************************************************************
+**  Function
+**  kinematics_mix | int16_t, int16_t, int16_t &, int16_t &
+****************************************************************************/
+//! @param linear	| linear velocity. mm/s, forward positive
+//! @param angular	| angular velocity. mrad/s, counterclockwise positive
+//! @param right	| output. speed of the right side. mm/s, forward positive
+//! @param left		| output. speed of the left side. mm/s, forward positive
+//! @return void |
+//! @brief Mix linear and angular velocity into the speed of the two sides
+//! @details Applies the curvature limit, then scales both sides to fit max_speed
+/***************************************************************************/
+
+void kinematics_mix( int16_t linear, int16_t angular, int16_t &right, int16_t &left )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//angular velocity after the curvature limit. mrad/s
+	int32_t w = angular;
+	//maximum angular velocity allowed by the curvature limit. mrad/s
+	int32_t w_max;
+	//half the difference between the sides. mm/s
+	int32_t diff;
+	//speed of the sides. mm/s
+	int32_t r, l;
+	//fastest side. mm/s
+	int32_t peak, peak_l;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: curvature limit is enabled
+	if (kinematics.max_curvature != 0)
+	{
+		w_max = ((int32_t)kinematics.max_curvature *((linear < 0)?(-(int32_t)linear):(linear))) /1000;
+		w = AT_SAT( w, w_max, -w_max );
+	}
+	//mrad/s *mm /2 /1000 = mm/s
+	diff = (w *kinematics.track) /2000;
+	r = linear +diff;
+	l = linear -diff;
+	//Scale both sides by the same factor. track and max_speed are bounded so that this fits 32bit
+	peak = (r < 0)?(-r):(r);
+	peak_l = (l < 0)?(-l):(l);
+	if (peak_l > peak)
+	{
+		peak = peak_l;
+	}
+	//if: a side doesn't fit
+	if (peak > kinematics.max_speed)
+	{
+		r = (r *kinematics.max_speed) /peak;
+		l = (l *kinematics.max_speed) /peak;
+	}
+	right = r;
+	left = l;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: kinematics_mix
+
+/****************************************************************************
+**  Function
+**  set_platform_pwm | int32_t, int32_t
+****************************************************************************/
+//! @param right	| duty of the right side. Q8 PWM. Forward positive
+//! @param left		| duty of the left side. Q8 PWM. Forward positive
+//! @return void |
+//! @brief Set the target duty of the motors of the two sides. Open loop
+//! @details The magnitude is clipped to DC_MOTOR_MAX_DUTY.
+//!	update_pwm will take care of trying to reach the desired setting
+/***************************************************************************/
+
+void set_platform_pwm( int32_t right, int32_t left )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//duty of the side of the motor. Q8 PWM
+	int32_t pwm;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Open loop. The PWM is set directly
+	f_speed_ctrl = false;
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		pwm = (kinematics_f_right[t] == true)?(right):(left);
+		pwm = AT_SAT( pwm, (int32_t)DC_MOTOR_MAX_DUTY, -(int32_t)DC_MOTOR_MAX_DUTY );
+		dc_motor_target.pwm[t] = (pwm < 0)?(-pwm):(pwm);
+		dc_motor_target.f_dir[t] = (pwm < 0)?(!speed_ctrl_fwd_dir[t]):(speed_ctrl_fwd_dir[t]);
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: set_platform_pwm
+
+/****************************************************************************
+**  Function
+**  set_platform_speed | int16_t, int16_t
+****************************************************************************/
+//! @param right	| speed of the right side. mm/s, forward positive
+//! @param left		| speed of the left side. mm/s, forward positive
+//! @return void |
+//! @brief Set the target speed of the wheels of the two sides. Closes the velocity loops
+/***************************************************************************/
+
+void set_platform_speed( int16_t right, int16_t left )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		speed_ctrl[t].target = (kinematics_f_right[t] == true)?(right):(left);
+	}
+	f_speed_ctrl = true;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: set_platform_speed
+
+/***************************************************************************/
+//!	@brief set linear and angular velocity of the platform. Closed loop
+//!	platform_twist_handler | int16_t, int16_t
+/***************************************************************************/
+//! @param linear	| linear velocity. mm/s, forward positive
+//! @param angular	| angular velocity. mrad/s, counterclockwise positive
+//! @return void
+//!	@details
+//! Handler for the platform twist command. Closes the velocity loops
+/***************************************************************************/
+
+void platform_twist_handler( int16_t linear, int16_t angular )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//speed of the sides. mm/s
+	int16_t right, left;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	kinematics_mix( linear, angular, right, left );
+	set_platform_speed( right, left );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: platform_twist_handler | int16_t, int16_t
+
+/***************************************************************************/
+//!	@brief set linear and angular velocity of the platform. Open loop
+//!	platform_twist_pwm_handler | int16_t, int16_t
+/***************************************************************************/
+//! @param linear	| linear velocity. mm/s, forward positive
+//! @param angular	| angular velocity. mrad/s, counterclockwise positive
+//! @return void
+//!	@details
+//! Handler for the open loop platform twist command. max_speed is mapped to DC_MOTOR_MAX_DUTY
+/***************************************************************************/
+
+void platform_twist_pwm_handler( int16_t linear, int16_t angular )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//speed of the sides. mm/s
+	int16_t right, left;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	kinematics_mix( linear, angular, right, left );
+	//mm/s to Q8 PWM
+	set_platform_pwm( ((int32_t)right *DC_MOTOR_MAX_DUTY) /kinematics.max_speed, ((int32_t)left *DC_MOTOR_MAX_DUTY) /kinematics.max_speed );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: platform_twist_pwm_handler | int16_t, int16_t
+
+/***************************************************************************/
+//!	@brief set geometry and limits of the platform
+//!	kinematics_handler | uint16_t, uint16_t, uint16_t
+/***************************************************************************/
+//! @param track			| distance between the left and right wheels. mm
+//! @param max_speed		| maximum speed of a side. mm/s
+//! @param max_curvature	| maximum curvature of the path. mrad/m. 0 = no limit
+//! @return void
+//!	@details
+//! Handler for the kinematics configuration command. Zero or out of range track and speed are ignored.
+//! PLATFORM_TRACK_MAX and INT16_MAX keep the mixing inside 32bit
+/***************************************************************************/
+
+void kinematics_handler( uint16_t track, uint16_t max_speed, uint16_t max_curvature )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: the geometry makes no sense
+	if ((track == 0) || (track > PLATFORM_TRACK_MAX) || (max_speed == 0) || (max_speed > INT16_MAX))
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	kinematics.track = track;
+	kinematics.max_speed = max_speed;
+	kinematics.max_curvature = max_curvature;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: kinematics_handler | uint16_t, uint16_t, uint16_t
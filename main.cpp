@@ -44,6 +44,13 @@
 **	uC_PWM		|	PA2,B20	|	PA3,B21	|	PB4,B22	|	PB5,B23	|	PWM
 **	uC_CTRLA	|	PA4		|	PA6		|	PB2		|	PD6		|	INA, SEL0
 **	uC_CTRLB	|	PA5		|	PA7		|	PB3		|	PD7		|	INB
+**	uC_SENSE	|	PD0,AIN0|	PD1,AIN1|	PD2,AIN2|	PD3,AIN3|	MULTISENSE
+**
+**	ENCODERS
+**				|	ENC0	|	ENC1	|	ENC2	|	ENC3
+**	-------------------------------------------------------------
+**	CHA			|	PC0		|	PC2		|	PC4		|	PC6
+**	CHB			|	PC1		|	PC3		|	PC5		|	PC7
 
 ****************************************************************/
 
@@ -65,8 +72,6 @@
 
 
 #include "global.h"
-//Universal Parser V4
-#include "uniparser.h"
 
 /****************************************************************
 ** FUNCTION PROTOTYPES
@@ -78,11 +83,24 @@
 
 //Initialize motors
 extern void init_motors( void );
-//Set direction and speed setting of the VNH7040 controlled motor
-extern void set_vnh7040_speed( uint8_t index, bool f_dir, uint8_t speed );
-//Set PWM of all motor channels applying slew rate limiting
+//Check whether the selected drivers can be written together now
+extern bool vnh7040_sync_ready( uint8_t mask );
+//Wait for a window of the PWM period where the selected drivers can be written together
+extern uint8_t vnh7040_sync_begin( uint8_t mask );
+//Apply the current setting of the selected motors to the VNH7040 drivers. One write per port
+extern void apply_vnh7040( uint8_t mask );
+//Set PWM of all motor channels through the ramp generators
 extern void update_pwm( void );
 
+	///----------------------------------------------------------------------
+	///	TASKS
+	///----------------------------------------------------------------------
+
+//Blink the activity LED. Speed depends on the communication timeout
+extern void led_task( void );
+//Update the communication timeout counter and the tier of the timeout
+extern void timeout_task( void );
+
 	///----------------------------------------------------------------------
 	///	PARSER
 	///----------------------------------------------------------------------
@@ -95,8 +113,12 @@ extern void ping_handler( void );
 extern void signature_handler( void );
 //Handler for the motor speed set command
 extern void set_speed_handler( int16_t motor_index, int16_t pwm );
-//Handler for the platform speed. Firmware handles logical configuration of the motors. TODO: evolve to forward and turn
+//Handler for the platform speed. Firmware handles logical configuration of the motors
 extern void set_platform_speed_handler(int16_t right, int16_t left );
+//Handler for the stop and reversal mode command
+extern void stop_mode_handler( uint8_t index, uint8_t stop_mode, uint8_t reverse_mode, uint8_t brake_pwm );
+//Set the tiers of the communication timeout
+extern void com_timeout_handler( uint8_t hold, uint8_t decel, uint8_t stop );
 
 
 /****************************************************************
@@ -108,15 +130,11 @@ volatile Isr_flags g_isr_flags;
 	///----------------------------------------------------------------------
 	///	BUFFERS
 	///----------------------------------------------------------------------
-	//	Buffers structure and data vectors
+	//	Data vectors of the USART port buffers
 
-//Safe circular buffer for UART input data
-volatile At_buf8_safe rpi_rx_buf;
-//Safe circular buffer for uart tx data
-At_buf8 rpi_tx_buf;
-//allocate the working vector for the buffer
+//allocate the working vector for the RPI RX buffer
 uint8_t v0[ RPI_RX_BUF_SIZE ];
-//allocate the working vector for the buffer
+//allocate the working vector for the RPI TX buffer
 uint8_t v1[ RPI_TX_BUF_SIZE ];
 
 	///--------------------------------------------------------------------------
@@ -124,20 +142,96 @@ uint8_t v1[ RPI_TX_BUF_SIZE ];
 	///--------------------------------------------------------------------------
 
 //Board Signature
-U8 *board_sign = (U8 *)"Seeker-Of-Ways-B-00002";
+U8 board_sign[] = "Seeker-Of-Ways-B-00002";
+static_assert( sizeof(board_sign) -1 == BOARD_SIGN_LEN, "BOARD_SIGN_LEN must match the board signature" );
+//Commands the parser refused at boot. Reported by the reset cause query
+uint8_t g_parser_err = 0;
 //communication timeout counter
 U8 uart_timeout_cnt = 0;
 //Communication timeout has been detected
 bool f_timeout_detected = false;
+//Tiers of the communication timeout
+Com_timeout com_timeout = { COM_TIMEOUT_HOLD, COM_TIMEOUT_DECEL, RPI_COM_TIMEOUT, COM_TIER_OK };
+//System ticks elapsed since boot
+uint16_t g_tick_cnt = 0;
 
 	///--------------------------------------------------------------------------
 	///	MOTORS
 	///--------------------------------------------------------------------------
 
+//DC Motor channels current setting. Mirrors the drivers
+Dc_motor_state dc_motor;
 //Desired setting for the DC motor channels
-Dc_motor_pwm dc_motor[DC_MOTOR_NUM];
-//Two DC Motor channels
-Dc_motor_pwm dc_motor_target[DC_MOTOR_NUM];
+Dc_motor_state dc_motor_target;
+//Stop and reversal modes of the DC motors
+Motor_stop motor_stop;
+
+	///--------------------------------------------------------------------------
+	///	VNH7040 DRIVERS
+	///--------------------------------------------------------------------------
+	//	Pin mapping of the USED PINS table. INA doubles as SEL0
+
+const Vnh7040_desc vnh7040_desc[DC_MOTOR_NUM] =
+{
+	//Port		INA		INB		PWM timer
+	//DRV0. PA4, PA5, PA2
+	{ &PORTA,	0x10,	0x20,	&TCB0 },
+	//DRV1. PA6, PA7, PA3
+	{ &PORTA,	0x40,	0x80,	&TCB1 },
+	//DRV2. PB2, PB3, PB4
+	{ &PORTB,	0x04,	0x08,	&TCB2 },
+	//DRV3. PD6, PD7, PB5
+	{ &PORTD,	0x40,	0x80,	&TCB3 },
+};
+
+//Integer part of the duty of the drivers. Read by the dither ISR
+volatile uint8_t g_pwm_base[DC_MOTOR_NUM];
+//Fraction of the duty of the drivers. Read by the dither ISR
+volatile uint8_t g_pwm_frac[DC_MOTOR_NUM];
+//Dither accumulators. Written by the dither ISR
+volatile uint8_t g_pwm_acc[DC_MOTOR_NUM];
+//Compare last written in the timer of each driver
+volatile uint8_t g_pwm_duty[DC_MOTOR_NUM];
+
+	///--------------------------------------------------------------------------
+	///	SCHEDULER
+	///--------------------------------------------------------------------------
+	//	Period and phase in system ticks. Lower priority value runs first
+	//	Slow tasks are given different phases so they don't share a tick
+
+Task task_table[] =
+{
+	//Handler				Period	Phase	Priority	Cnt, Stats are set by init_scheduler
+	//Measure the wheel speeds and run the velocity loops. 51.2Hz
+	{ &speed_ctrl_task,		SPEED_CTRL_PERIOD,	4,	0,	0, {} },
+	//Filter the motor currents accumulated by the ADC ISR
+	{ &update_current,		1,		0,		0,		0, {} },
+	//Update PWM of the motors through the ramp generators
+	{ &update_pwm,			1,		0,		0,		0, {} },
+	//Driver diagnostic window. Right after update_pwm to have the most slack. 8Hz
+	{ &diag_task,			DIAG_PERIOD,	5,	0,		0, {} },
+	//Answer the sequence numbered commands received since the last tick
+	{ &update_seq,			1,		0,		1,		0, {} },
+	//Answer the queries that didn't fit the TX buffer. Before the telemetry, which throttles itself
+	{ &update_reply,		1,		0,		1,		0, {} },
+	//Stream the motor state to the RPI if subscribed. Has its own subscription period
+	{ &update_telemetry,	1,		0,		2,		0, {} },
+	//Communication timeout. 100Hz
+	{ &timeout_task,		5,		1,		3,		0, {} },
+	//Activity LED. 100Hz prescaler
+	{ &led_task,			5,		3,		4,		0, {} },
+	//Idle time percentage. 250ms window
+	{ &idle_task,			128,	2,		5,		0, {} },
+};
+//The task statistics query takes the index of the task as the argument of its reply
+static_assert( sizeof(task_table) /sizeof(Task) <= REPLY_ARG_NUM, "too many tasks for the task statistics query" );
+
+	///--------------------------------------------------------------------------
+	///	LED
+	///--------------------------------------------------------------------------
+
+//activity LED prescaler
+uint8_t pre_led = 0;
 
 /****************************************************************************
 **  Function
@@ -154,37 +248,48 @@ int main(void)
 	//	VARS
 	//----------------------------------------------------------------
 
-	//system tick prescaler
-	uint8_t pre = 0;
-	//activity LED prescaler
-	uint8_t pre_led = 0;
-	
-	//Blink speed of the LED. Start slow
-	uint8_t blink_speed = 99;
 	//Raspberry PI UART RX Parser
-	Orangebot::Uniparser rpi_rx_parser = Orangebot::Uniparser();
+	Orangebot::Uniparser &rpi_rx_parser = g_uart_port[UART_PORT_RPI].parser;
 	
 	//----------------------------------------------------------------
 	//	INIT
 	//----------------------------------------------------------------
 
-		///UART RX BUFFER INIT
-	//I init the rx and tx buffers
-	//attach vector to buffer
-	AT_BUF_ATTACH( rpi_rx_buf, v0, RPI_RX_BUF_SIZE);
-	//attach vector to buffer
-	AT_BUF_ATTACH( rpi_tx_buf, v1, RPI_TX_BUF_SIZE);
+	//! Record the cause of the last reset. Before the watchdog is enabled
+	init_watchdog();
+
+		///UART PORTS INIT
+	//Bind USART3 and the rx and tx vectors to the RPI port
+	init_uart_port( g_uart_port[UART_PORT_RPI], USART3, v0, RPI_RX_BUF_SIZE, v1, RPI_TX_BUF_SIZE );
 
+	//! Initialize encoders and velocity loops
+	init_speed_ctrl();
+	//! Initialize the geometry of the platform
+	init_kinematics();
+	//! Initialize the motor current filters. Before the ADC starts
+	init_current();
+	//! Initialize the driver diagnostic. Before the ADC starts
+	init_diag();
 	//! Initialize AT4809 internal peripherals
 	init();
 	//! Initialize external peripherals
 	init_motors();
+	//! Initialize the ramp generators of the motors
+	init_trajectory();
+	//! Initialize the telemetry stream
+	init_telemetry();
+	//! Initialize the section profiler
+	#ifdef ENABLE_PROFILE
+	init_profile();
+	#endif
+	//! Initialize the scheduler with the task table
+	init_scheduler( task_table, sizeof(task_table) /sizeof(Task) );
 
 
 		//!	Initialize VNH7040
 	//Enable sense output
 	SET_BIT_VALUE( PORTF.OUT, 0, true );
-	//Diagnostic mode OFF
+	//Diagnostic mode OFF. diag_task raises it for the diagnostic window
 	SET_BIT_VALUE( PORTF.OUT, 1, false );
 	
 		///----------------------------------------------------------------------
@@ -192,14 +297,57 @@ int main(void)
 		///----------------------------------------------------------------------
 
 	//! Register commands and handler for the universal parser class. A masterpiece :')
+	//A command that doesn't fit UNIPARSER_MAX_CMD or has a bad syntax is refused. Count them
 	//Register ping command. It's used to reset the communication timeout
-	rpi_rx_parser.add_cmd( "P", (void *)&ping_handler );
+	g_parser_err += rpi_rx_parser.add_cmd( "P", (void *)&ping_handler );
 	//Register the Find command. Board answers with board signature
-	rpi_rx_parser.add_cmd( "F", (void *)&signature_handler );
-	//Set individual motor speed command. mm/s
-	rpi_rx_parser.add_cmd( "M%SPWM%S", (void *)&set_speed_handler );
+	g_parser_err += rpi_rx_parser.add_cmd( "F", (void *)&signature_handler );
+	//Reset cause query. Reset flags of the last boot, heartbeats missing on a watchdog reset, refused commands. Registered early to always be there
+	g_parser_err += rpi_rx_parser.add_cmd( "RST", (void *)&reset_cause_handler );
+	//Set individual motor PWM command. Open loop
+	g_parser_err += rpi_rx_parser.add_cmd( "M%SPWM%S", (void *)&set_speed_handler );
 	//Set platform speed handler to be retro compatible with SoW-B
-	rpi_rx_parser.add_cmd( "PWMR%SL%S", (void *)&set_platform_speed_handler );
+	g_parser_err += rpi_rx_parser.add_cmd( "PWMR%SL%S", (void *)&set_platform_speed_handler );
+	//Set platform velocity in mm/s. Closes the velocity loops
+	g_parser_err += rpi_rx_parser.add_cmd( "VR%SL%S", (void *)&platform_velocity_handler );
+	//Set platform linear and angular velocity. mm/s, mrad/s. Closes the velocity loops
+	g_parser_err += rpi_rx_parser.add_cmd( "VF%SW%S", (void *)&platform_twist_handler );
+	//Set platform linear and angular velocity. mm/s, mrad/s. Open loop
+	g_parser_err += rpi_rx_parser.add_cmd( "PWMF%SW%S", (void *)&platform_twist_pwm_handler );
+	//Set platform geometry and limits. Track mm, max speed of a side mm/s, max curvature mrad/m
+	g_parser_err += rpi_rx_parser.add_cmd( "KIN%UV%UC%U", (void *)&kinematics_handler );
+	//Set the gains of the velocity loops. Q8
+	g_parser_err += rpi_rx_parser.add_cmd( "KP%SKI%S", (void *)&speed_gain_handler );
+	//Set the ramp limits of a motor. Index, ACCEL, DECEL, JERK. Q8 PWM per tick
+	g_parser_err += rpi_rx_parser.add_cmd( "TRJ%UA%UD%UJ%U", (void *)&trajectory_handler );
+	//Set the stop and reversal modes of a motor. Index, stop 0 ramp 1 coast 2 brake, reversal 0 ramp 1 brake, brake PWM
+	g_parser_err += rpi_rx_parser.add_cmd( "STP%uS%uR%uB%u", (void *)&stop_mode_handler );
+	//Set the tiers of the communication timeout. Hold, decelerate, stop. About 10ms units
+	g_parser_err += rpi_rx_parser.add_cmd( "TMO%uD%uS%u", (void *)&com_timeout_handler );
+	//Subscribe to the motor state telemetry. Argument is the period in system ticks. 0 stops the stream
+	g_parser_err += rpi_rx_parser.add_cmd( "TLM%u", (void *)&telemetry_handler );
+	//Sequence number prefix. The next command is answered with a cumulative ACK/NAK
+	g_parser_err += rpi_rx_parser.add_cmd( "SEQ%u", (void *)&seq_handler );
+	//Task statistics query. Argument is the index of the task in priority order
+	g_parser_err += rpi_rx_parser.add_cmd( "TSK%u", (void *)&task_stats_handler );
+	//System tick statistics query. Overruns and worst case loop latency
+	g_parser_err += rpi_rx_parser.add_cmd( "TCK", (void *)&tick_stats_handler );
+	//Motor current query. Filtered currents in mA
+	g_parser_err += rpi_rx_parser.add_cmd( "CUR", (void *)&current_handler );
+	//Set the current limits of a motor. Index, continuous limit mA, trip mA. 0 disables
+	g_parser_err += rpi_rx_parser.add_cmd( "ILIM%UL%UT%U", (void *)&current_limit_handler );
+	//Driver diagnostic query. Fault flags, TCHIP and VCC of the drivers
+	g_parser_err += rpi_rx_parser.add_cmd( "DIAG", (void *)&diag_handler );
+	#ifdef ENABLE_PROFILE
+	//Profiler dump. Argument is the profiled section
+	g_parser_err += rpi_rx_parser.add_cmd( "PRF%u", (void *)&profile_handler );
+	#endif
+	#ifdef ENABLE_TRACE
+	//Trace dump. Argument is the chunk of the ring. Chunk 0 freezes the ring until the last chunk is sent
+	g_parser_err += rpi_rx_parser.add_cmd( "TRC%u", (void *)&trace_handler );
+	//Release the trace ring without dumping the rest of it
+	g_parser_err += rpi_rx_parser.add_cmd( "TRCX", (void *)&trace_release_handler );
+	#endif
 	
 	//----------------------------------------------------------------
 	//	BODY
@@ -208,114 +356,33 @@ int main(void)
 	//Main loop
 	for EVER
 	{
-		//If: System Tick 500Hz
-		if (g_isr_flags.system_tick == 1)
-		{
-			//Clear system tick
-			g_isr_flags.system_tick = 0;
-			
-			//----------------------------------------------------------------
-			//	FULL SPEED CODE
-			//----------------------------------------------------------------
-			
-			//Update PWM of the motors while applying the slew rate limiter
-			update_pwm();
-			
-			//----------------------------------------------------------------
-			//	SYSTEM PRESCALER SPEED CODE
-			//----------------------------------------------------------------
-				
-			//If prescaler has reset
-			if (pre == 0)
-			{
-				//----------------------------------------------------------------
-				//	LED BLINK
-				//----------------------------------------------------------------
-				//		Two speeds
-				//	slow: not in timeout and commands can be executed
-				//	fast: in timeout, motor stopped
-				
-				if (pre_led == 0)
-				{
-					//Toggle PF5.
-					SET_BIT( PORTF.OUTTGL, 5 );	
-				}
-				//Increment with top
-				pre_led = AT_TOP_INC( pre_led, blink_speed );
-				
-				//----------------------------------------------------------------
-				//	PARSER TIMEOUT
-				//----------------------------------------------------------------
-				
-				//Update communication timeout counter
-				uart_timeout_cnt++;
-				//
-				if (uart_timeout_cnt >= RPI_COM_TIMEOUT)
-				{
-					//Clip timeout counter
-					uart_timeout_cnt = RPI_COM_TIMEOUT;
-					//If: it's the first time the communication timeout is detected
-					if (f_timeout_detected == false)
-					{						
-						//LED is blinking faster
-						blink_speed = 9;
-					}
-					//raise the timeout flag
-					f_timeout_detected = true;
-				}
-				else
-				{
-					//This is the only code allowed to reset the timeout flag
-					f_timeout_detected = false;
-					//LED is blinking slower
-					blink_speed = 99;
-				}
-			}
-			//Increment prescaler and reset if it exceeds the TOP.
-			pre = AT_TOP_INC( pre, 4);
-			
-		}	//End If: System Tick
-		
 		//----------------------------------------------------------------
-		//	AT4809 --> RPI USART TX
+		//	SYSTEM TICK 500Hz
 		//----------------------------------------------------------------
-		
-		//if: RPI TX buffer is not empty and the RPI TX HW buffer is ready to transmit
-		if ( (AT_BUF_NUMELEM( rpi_tx_buf ) > 0) && (IS_BIT_ONE(USART3.STATUS, USART_DREIF_bp)))
-		{
-			//temp var
-			uint8_t tx_tmp;
-			//Get the byte to be filtered out
-			tx_tmp = AT_BUF_PEEK( rpi_tx_buf );
-			AT_BUF_KICK( rpi_tx_buf );
-			//Send data through the UART3
-			USART3.TXDATAL = tx_tmp;
-		}	//End If: RPI TX
+
+		//Run the tasks of each System Tick elapsed since the last pass
+		scheduler_service();
 		
 		//----------------------------------------------------------------
-		//	RPI --> AT4809 USART RX
+		//	USART PORTS TX AND RX
 		//----------------------------------------------------------------
 		
-		//if: RX buffer is not empty	
-		if (AT_BUF_NUMELEM( rpi_rx_buf ) > 0)
-		{
-			//temp var
-			uint8_t rx_tmp;
-				
-				///Get data
-			//Get the byte from the RX buffer (ISR put it there)
-			rx_tmp = AT_BUF_PEEK( rpi_rx_buf );
-			AT_BUF_KICK_SAFER( rpi_rx_buf );
-
-				///Loopback
-			//Push into tx buffer
-			//AT_BUF_PUSH( rpi_tx_buf, rx_tmp );
-
-				///Command parser
-			//feed the input RX byte to the parser
-			rpi_rx_parser.exe( rx_tmp );
-			
-		} //endif: RPI RX buffer is not empty
+		//Move one TX byte and feed one RX byte to the parser of each port
+		uart_port_service();
+
+		//----------------------------------------------------------------
+		//	WATCHDOG
+		//----------------------------------------------------------------
+
+		//Feed the watchdog if all the jobs checked in
+		watchdog_service();
+
+		//----------------------------------------------------------------
+		//	IDLE
+		//----------------------------------------------------------------
+
+		//Sleep until the next interrupt if there is nothing left to do
+		scheduler_idle();
 
 	}	//End: Main loop
 
@@ -357,17 +424,24 @@ void init_motors( void )
 	for (t = 0;t < DC_MOTOR_NUM;t++)
 	{
 		//Initialize motor
-		dc_motor[t].f_dir = false;
-		dc_motor[t].pwm = (uint8_t)0x00;
+		dc_motor.f_dir[t] = false;
+		dc_motor.f_brake[t] = false;
+		dc_motor.pwm[t] = (uint16_t)0x0000;
+		dc_motor_target.f_dir[t] = false;
+		dc_motor_target.f_brake[t] = false;
+		dc_motor_target.pwm[t] = (uint16_t)0x0000;
+		g_pwm_base[t] = 0;
+		g_pwm_frac[t] = 0;
+		g_pwm_acc[t] = 0;
+		g_pwm_duty[t] = 0;
+		//Ramp through zero, as the motors always did
+		motor_stop.stop_mode[t] = MOTOR_STOP_RAMP;
+		motor_stop.reverse_mode[t] = MOTOR_REVERSE_RAMP;
+		motor_stop.brake_pwm[t] = DC_MOTOR_MAX_PWM;
+		motor_stop.brake_cnt[t] = 0;
 	}	//End For: scan motors
-	
-	//For: scan motors
-	for (t = 0;t < DC_MOTOR_NUM;t++)
-	{
-		//Initialize motor
-		dc_motor_target[t].f_dir = false;
-		dc_motor_target[t].pwm = (uint8_t)0x00;
-	}
+	//Write every driver once. update_pwm only writes the drivers whose setting changes
+	apply_vnh7040( MASK( DC_MOTOR_NUM ) -1 );
 	
 	//----------------------------------------------------------------
 	//	RETURN
@@ -378,320 +452,491 @@ void init_motors( void )
 
 /****************************************************************************
 **  Function
-**  set_vnh7040_speed
+**  vnh7040_sync_ready | uint8_t
 ****************************************************************************/
-//! @return void |
-//! @param index	| index of the motor to be controlled. 0 to 3
-//! @param f_dir	| direction of rotation of the motor
-//! @param speed	| Speed of the motor
-//! @brief Set direction and speed setting of the VNH7040 controlled motor
-//! @details 
-//!
+//! @return bool | true = write now. In the window, or there is no window to wait for
+//! @param mask	| bit n = driver n takes part in the commit
+//! @brief Check whether the selected drivers can be written together now
+//! @details All the timers type B count CLK_TCA in phase, init restarts TCA0 once they are
+//!	enabled and SYNCUPD restarts them with it. The count of TCB0 stands for all of them.
+//!	In the window the pulses of the selected drivers are over and the burst ends before the
+//!	end of the period: the direction pins change while the outputs are low, and the new
+//!	compares take effect together at the next period boundary.
+//!	If a pulse leaves no window, or the period is longer than PWM_SYNC_MAX_CYCLES, it's always time
 /***************************************************************************/
 
-void set_vnh7040_speed( uint8_t index, bool f_dir, uint8_t speed )
+bool vnh7040_sync_ready( uint8_t mask )
 {
 	//----------------------------------------------------------------
 	//	VARS
 	//----------------------------------------------------------------
 
-	//----------------------------------------------------------------
-	//	INIT
-	//----------------------------------------------------------------
-	
+	//counter
+	uint8_t t;
+	//end of the longest pulse of the selected drivers
+	uint8_t start;
+	//count of TCB0
+	uint8_t cnt;
+	//the drivers can be written
+	bool f_ready = true;
+
 	//----------------------------------------------------------------
 	//	BODY
 	//----------------------------------------------------------------
 
-	//Driver 0
-	if (index == 0)
+	#ifdef ENABLE_PWM_SYNC
+	//if: the period is short enough to wait for
+	if (PWM_SYNC_WAIT == true)
 	{
-		//Set INA, INB and SEL0 to select the direction of rotation of the motor
-		if (f_dir == true)
-		{
-			SET_MASKED_BIT( PORTA.OUT, 0x30, 0x10);
-		}
-		else
+		//The dither ISR may have moved the compares since the last check
+		start = 0;
+		//For: each driver
+		for (t = 0;t < DC_MOTOR_NUM;t++)
 		{
-			SET_MASKED_BIT( PORTA.OUT, 0x30, 0x20);
+			if ((IS_BIT_ONE( mask, t ) == true) && (g_pwm_duty[t] > start))
+			{
+				start = g_pwm_duty[t];
+			}
 		}
-		//Set the PWM value of the right PWM channel of TCA0
-		TCB0.CCMPH = speed;	
+		cnt = TCB0.CNTL;
+		//Ready if the pulse leaves no window, or the pulses are over and the burst fits the period
+		f_ready = ((int16_t)start >= (int16_t)PWM_TOP -PWM_SYNC_BURST_CNT) || ((cnt > start) && ((int16_t)cnt <= (int16_t)PWM_TOP -PWM_SYNC_BURST_CNT));
 	}
-	//Driver 1
-	else if (index == 1)
+	#else
+	(void)mask;
+	#endif
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return f_ready;
+}	//End: vnh7040_sync_ready
+
+/****************************************************************************
+**  Function
+**  vnh7040_sync_begin | uint8_t
+****************************************************************************/
+//! @return uint8_t | status register to restore at the end of the commit
+//! @param mask	| bit n = driver n takes part in the commit
+//! @brief Wait for a window of the PWM period where the selected drivers can be written together
+//! @details Returns with the interrupts disabled, see vnh7040_sync_ready for the window.
+//!	The wait is at most one PWM period, longer than a byte of the RPI USART, so it's done
+//!	with the interrupts on. They are off only from the last check of the window to the
+//!	end of the burst
+/***************************************************************************/
+
+uint8_t vnh7040_sync_begin( uint8_t mask )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Loop: until the counter is in the window with the interrupts off
+	while (true)
 	{
-		//Set INA, INB and SEL0 to select the direction of rotation of the motor
-		if (f_dir == true)
+		//Wait: for the window with the interrupts on
+		while (vnh7040_sync_ready( mask ) == false)
 		{
-			SET_MASKED_BIT( PORTA.OUT, 0xc0, 0x40);
 		}
-		else
+		sreg_tmp = SREG;
+		cli();
+		//if: still in the window. An interrupt before cli may have used it up
+		if (vnh7040_sync_ready( mask ) == true)
 		{
-			SET_MASKED_BIT( PORTA.OUT, 0xc0, 0x80);
+			break;
 		}
-		//Set the PWM value of the right PWM channel of TCA0
-		TCB1.CCMPH = speed;
+		SREG = sreg_tmp;
+	}	//End Loop: until the counter is in the window with the interrupts off
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return sreg_tmp;
+}	//End: vnh7040_sync_begin
+
+/****************************************************************************
+**  Function
+**  apply_vnh7040 | uint8_t
+****************************************************************************/
+//! @return void |
+//! @param mask	| bit n = apply the setting of motor n
+//! @brief Apply the current setting of the selected motors to the VNH7040 drivers
+//! @details Drivers that share a port have their INA and INB bits merged,
+//!	the port is read and written once. Pins and timers come from vnh7040_desc.
+//!	The integer part of the duty goes to the timer, the fraction to the dither ISR.
+//!	The TCB0 period interrupt is only enabled while a duty has a fraction.
+//!	The new settings are staged, then pins and timers of all the selected drivers
+//!	are written in one burst inside a window of the PWM period, see vnh7040_sync_begin.
+//!	A driver tripped by the ADC ISR keeps a zero duty
+/***************************************************************************/
+
+void apply_vnh7040( uint8_t mask )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counters
+	uint8_t t, ti;
+	//new value of the port
+	uint8_t out;
+	//drivers whose port has been written
+	uint8_t done = 0;
+	//duty in counts of the timer. Q8
+	uint16_t cnt;
+	//staged integer part and fraction of the duties
+	uint8_t base[DC_MOTOR_NUM], frac[DC_MOTOR_NUM];
+	//a duty has a fraction to dither
+	bool f_dither = false;
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+		///Stage
+	//For: each driver
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		cnt = pwm_duty_cnt( dc_motor.pwm[t] );
+		base[t] = U16H( cnt );
+		#ifdef ENABLE_PWM_DITHER
+		frac[t] = U16L( cnt );
+		#else
+		frac[t] = 0;
+		#endif
 	}
-	//Driver 2
-	else if (index == 2)
+
+		///Commit
+	//Wait for the pulses to be over. Interrupts stay disabled until the end of the burst
+	sreg_tmp = vnh7040_sync_begin( mask );
+	//For: each driver
+	for (t = 0;t < DC_MOTOR_NUM;t++)
 	{
-		//Set INA, INB and SEL0 to select the direction of rotation of the motor
-		if (f_dir == true)
+		//if: not selected or its port has already been written
+		if ((IS_BIT_ONE( mask, t ) == false) || (IS_BIT_ONE( done, t ) == true))
 		{
-			SET_MASKED_BIT( PORTB.OUT, 0x0c, 0x04);
+			continue;
 		}
-		else
+		PORT_t *port = vnh7040_desc[t].port;
+		//Single read of the port
+		out = port -> OUT;
+		//For: this driver and the following ones on the same port
+		for (ti = t;ti < DC_MOTOR_NUM;ti++)
 		{
-			SET_MASKED_BIT( PORTB.OUT, 0x0c, 0x08);
+			const Vnh7040_desc &desc = vnh7040_desc[ti];
+			//if: selected and on the same port
+			if ((IS_BIT_ONE( mask, ti ) == true) && (desc.port == port))
+			{
+				//Active brake to GND pulls both INA and INB low
+				SET_MASKED_BIT( out, desc.ina_mask | desc.inb_mask, (dc_motor.f_brake[ti] != false)?(0):((dc_motor.f_dir[ti] != false)?(desc.ina_mask):(desc.inb_mask)) );
+				SET_BIT( done, ti );
+			}
 		}
-		//Set the PWM value of the right PWM channel of TCA0
-		TCB2.CCMPH = speed;
-	}
-	//Driver 3
-	else if (index == 3)
+		//Single write of the port
+		port -> OUT = out;
+	}	//End For: each driver
+	//For: each driver. Back to back, the timers take the new compares on the same period
+	for (t = 0;t < DC_MOTOR_NUM;t++)
 	{
-		//Set INA, INB and SEL0 to select the direction of rotation of the motor
-		if (f_dir == true)
+		if (IS_BIT_ONE( mask, t ) == true)
 		{
-			SET_MASKED_BIT( PORTD.OUT, 0xc0, 0x40);
-		}
-		else
-		{
-			SET_MASKED_BIT( PORTD.OUT, 0xc0, 0x80);
+			//if: the ADC ISR tripped the driver after the duty was staged. It stays off until update_pwm sees the trip
+			if (IS_BIT_ONE( g_adc_trip_mask, t ) == true)
+			{
+				base[t] = 0;
+				frac[t] = 0;
+			}
+			g_pwm_base[t] = base[t];
+			g_pwm_frac[t] = frac[t];
+			pwm_write( t, base[t] );
 		}
-		//Set the PWM value of the right PWM channel of TCA0
-		TCB3.CCMPH = speed;
 	}
-	//Default case
-	else
+	SREG = sreg_tmp;
+
+	#ifdef ENABLE_PWM_DITHER
+	//For: each driver
+	for (t = 0;t < DC_MOTOR_NUM;t++)
 	{
-		//Driver index not installed.
-		//Do nothing
+		f_dither |= (g_pwm_frac[t] != 0);
 	}
+	//Period interrupt of TCB0 runs the dither of all the drivers, once per PWM period. Off while no driver has a fraction
+	TCB0.INTCTRL = (f_dither == true)?(TCB_CAPT_bm):(0);
+	#endif
 
 	//----------------------------------------------------------------
 	//	RETURN
 	//----------------------------------------------------------------
-	
+
 	return;
-}	//End: 
+}	//End: apply_vnh7040
 
 /***************************************************************************/
-//!	@brief convert from a dc motor PWM structure to a speed number
-//!	convert_pwm_to_s16 | Dc_motor_pwm
+//!	@brief update DC motor PWM
+//!	update_pwm | void
 /***************************************************************************/
-//! @param input | Dc_motor_pwm	input PWM structure
-//! @param f_dir | bool			conversion between clockwise/counterclockwise to forward/backward
-//! @return int16_t |			speed number
+//! @return void
+//!	@details
+//! Move PWM toward target PWM through the ramp generator of each motor
+//! Target is clipped to DC_MOTOR_MAX_PWM. In the DECEL tier of the timeout the motors ramp down to zero
+//! whatever their stop mode, in the STOP tier the ramps are reset and the motors stop at once
+//! A zero target applies the stop mode of the motor. A change of direction applies the reversal mode:
+//! the active brake holds the ramp at zero until the wheel stops, then the ramp restarts from zero
+//! The drivers are only written when the PWM, the direction or the brake of a channel changes
 /***************************************************************************/
 
-inline int16_t convert_pwm_to_s16( Dc_motor_pwm input, bool f_dir )
+void update_pwm( void )
 {
 	//----------------------------------------------------------------
 	//	VARS
 	//----------------------------------------------------------------
 
-	//temp return
-	int16_t ret;
-
-	//----------------------------------------------------------------
-	//	INIT
-	//----------------------------------------------------------------
+	//Profile the whole function
+	PROFILE_SCOPE( PROFILE_UPDATE_PWM );
+	//temp counter
+	uint8_t t;
+	//signed duty. Q8 PWM. positive = f_dir true
+	int32_t target;
+	//output of the ramp generator. Q8
+	int32_t value;
+	//new setting of the channel
+	uint16_t pwm;
+	uint8_t f_dir, f_brake;
+	//measured speed of the wheel. mm/s
+	int16_t speed;
+	//bit n = setting of channel n changed
+	uint8_t change = 0;
+	//stop mode of the channel
+	uint8_t stop_mode;
 
 	//----------------------------------------------------------------
 	//	BODY
 	//----------------------------------------------------------------
 
-	//Extract PWM setting
-	ret = input.pwm;
-	//if: direction is backward
-	if (input.f_dir != f_dir)
+	//For: each DC motor channel
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		//Signed target, clipped
+		target = (dc_motor_target.f_dir[t] != false)?((int32_t)dc_motor_target.pwm[t]):(-(int32_t)dc_motor_target.pwm[t]);
+		target = AT_SAT( target, (int32_t)DC_MOTOR_MAX_DUTY, -(int32_t)DC_MOTOR_MAX_DUTY );
+		stop_mode = motor_stop.stop_mode[t];
+		//if: communication failed. Stop at once, without a ramp
+		if (f_timeout_detected == true)
+		{
+			target = 0;
+			trajectory.value[t] = 0;
+			trajectory.rate[t] = 0;
+		}
+		//if: communication is failing. Ramp down, a late command can pick up from there
+		else if (com_timeout.tier == COM_TIER_DECEL)
+		{
+			target = 0;
+			stop_mode = MOTOR_STOP_RAMP;
+		}
+
+			///Stop and reversal modes
+		f_brake = false;
+		//if: stop request
+		if (target == 0)
+		{
+			motor_stop.brake_cnt[t] = 0;
+			f_brake = (stop_mode == MOTOR_STOP_BRAKE);
+			//if: no ramp down
+			if (stop_mode != MOTOR_STOP_RAMP)
+			{
+				trajectory.value[t] = 0;
+				trajectory.rate[t] = 0;
+			}
+		}
+		//if: reversal request with active brake
+		else if ((motor_stop.reverse_mode[t] == MOTOR_REVERSE_BRAKE) && (((target > 0) && (trajectory.value[t] < 0)) || ((target < 0) && (trajectory.value[t] > 0))))
+		{
+			motor_stop.brake_cnt[t] = MOTOR_BRAKE_MAX_TICKS;
+		}
+		//if: reversal brake in progress
+		if (motor_stop.brake_cnt[t] > 0)
+		{
+			speed = speed_ctrl[t].speed;
+			speed = (speed < 0)?(-speed):(speed);
+			//if: the wheel stopped. The speed is trusted once it has been measured during the brake
+			if (((MOTOR_BRAKE_MAX_TICKS -motor_stop.brake_cnt[t]) >= MOTOR_BRAKE_MIN_TICKS) && (speed < MOTOR_BRAKE_STOP_SPEED))
+			{
+				motor_stop.brake_cnt[t] = 0;
+			}
+			else
+			{
+				motor_stop.brake_cnt[t]--;
+				f_brake = true;
+				//Ramp restarts from zero after the brake
+				trajectory.value[t] = 0;
+				trajectory.rate[t] = 0;
+			}
+		}
+
+			///Output
+		//if: active brake
+		if (f_brake == true)
+		{
+			//A tripped motor is held off, the active brake drives current as well
+			f_brake = (IS_BIT_ONE( g_adc_trip_mask, t ) == false) && (current_limit.hold[t] == 0);
+			//Keep the trip hold of the current limit running
+			current_limit_step( t, 0 );
+			pwm = (f_brake == true)?((uint16_t)motor_stop.brake_pwm[t] << 8):(0);
+			f_dir = dc_motor.f_dir[t];
+		}
+		else
+		{
+			//Advance the ramp
+			#ifdef ENABLE_PWM_CHECK
+			value = pwm_check_ramp( t, target );
+			#else
+			value = trajectory_step( t, target );
+			#endif
+			//Current limit stage
+			value = current_limit_step( t, value );
+			//Magnitude. Direction is kept while stopped
+			pwm = (uint16_t)((value < 0)?(-value):(value));
+			f_dir = (value > 0)?(true):((value < 0)?(false):(dc_motor.f_dir[t]));
+		}
+
+		//if: the setting of the channel changed
+		if ((pwm != dc_motor.pwm[t]) || (f_dir != dc_motor.f_dir[t]) || (f_brake != dc_motor.f_brake[t]))
+		{
+			//Write back setting
+			dc_motor.pwm[t] = pwm;
+			dc_motor.f_dir[t] = f_dir;
+			dc_motor.f_brake[t] = f_brake;
+			SET_BIT( change, t );
+		}
+	}	//End For: each DC motor channel
+	//if: some channel changed
+	if (change != 0)
 	{
-		//Correct sign
-		ret = -ret;
+		//Apply settings. Drivers on the same port share a single write
+		apply_vnh7040( change );
 	}
+	#ifdef ENABLE_PWM_CHECK
+	pwm_check_drivers( change );
+	#endif
 
 	//----------------------------------------------------------------
 	//	RETURN
 	//----------------------------------------------------------------
-	
-	return ret;
-}
+
+	return; //OK
+}	//End: update_pwm
 
 /***************************************************************************/
-//!	@brief convert from a speed number to a dc motor PWM structure
-//!	convert_s16_to_pwm | int16_t, bool
+//!	@brief activity LED task
+//!	led_task | void
 /***************************************************************************/
-//! @param input | int16_t 		Input speed number
-//! @param f_dir | bool			conversion between clockwise/counterclockwise to forward/backward
-//! @return Dc_motor_pwm		PWM structure
+//! @return void
+//!	@details
+//! Blink the activity LED. Called by the scheduler at 100Hz. Two speeds
+//!	slow: not in timeout and commands can be executed
+//!	fast: in timeout, motor stopped
 /***************************************************************************/
 
-inline Dc_motor_pwm convert_s16_to_pwm( int16_t input, bool f_dir )
+void led_task( void )
 {
 	//----------------------------------------------------------------
 	//	VARS
 	//----------------------------------------------------------------
 
-	//temp return
-	Dc_motor_pwm ret;
-
-	//----------------------------------------------------------------
-	//	INIT
-	//----------------------------------------------------------------
+	//Blink speed of the LED
+	uint8_t blink_speed = (f_timeout_detected == true)?(9):(99);
 
 	//----------------------------------------------------------------
 	//	BODY
 	//----------------------------------------------------------------
 
-	//For each DC motor channel
-	//If: right direction is backward
-	if (input < 0)
+	if (pre_led == 0)
 	{
-		//Assign the pwm to the right temp channel
-		ret.pwm = -input;
-		ret.f_dir = !f_dir;
-	}
-	//If: right direction is forward
-	else
-	{
-		//Assign the pwm to the right temp channel
-		ret.pwm = input;
-		ret.f_dir = f_dir;
+		//Toggle PF5.
+		SET_BIT( PORTF.OUTTGL, 5 );
 	}
+	//Increment with top. Clip first, the top shrinks when the timeout is detected
+	pre_led = (pre_led > blink_speed)?(blink_speed):(pre_led);
+	pre_led = AT_TOP_INC( pre_led, blink_speed );
 
 	//----------------------------------------------------------------
 	//	RETURN
 	//----------------------------------------------------------------
 
-	return ret;
-}
+	return;
+}	//end task: led_task | void
 
 /***************************************************************************/
-//!	@brief update DC motor PWM
-//!	update_pwm | void
+//!	@brief communication timeout task
+//!	timeout_task | void
 /***************************************************************************/
 //! @return void
 //!	@details
-//! Move PWM toward target PWM
-//! Apply slew rate limiter
+//! Update the communication timeout counter. Called by the scheduler at 100Hz
+//!	Handlers of the commands reset the counter
+//!	The silence moves the link through the tiers of com_timeout:
+//!	OK, HOLD the last setpoint, DECEL along the ramp limits, STOP
 /***************************************************************************/
 
-void update_pwm( void )
+void timeout_task( void )
 {
 	//----------------------------------------------------------------
 	//	VARS
 	//----------------------------------------------------------------
 
-	//temp counter
-	uint8_t t;
-	//true if speed has changed
-	//bool f_change[DC_MOTOR_NUM];
-
-	Dc_motor_pwm target_speed, actual_speed;
+	//tier before the update
+	uint8_t tier_old = com_timeout.tier;
 
 	//----------------------------------------------------------------
-	//	INIT
+	//	BODY
 	//----------------------------------------------------------------
 
-	//If the communication failed
-	if (f_timeout_detected == true)
+	//Update communication timeout counter. Clipped at the last tier
+	if (uart_timeout_cnt < com_timeout.stop)
 	{
-		//Counter
-		uint8_t t;
-		//For: scan motors
-		for (t = 0;t < DC_MOTOR_NUM;t++)
-		{
-			//Stop the motors
-			set_vnh7040_speed( (uint8_t)t, (uint8_t)false, (uint8_t)0x00 );
-			//Update actual PWM so tat slew rate limiter will do sensible things when restarting
-			dc_motor[t].pwm = (uint8_t)0x00;
-		}
-		//
-		return;
+		uart_timeout_cnt++;
 	}
-
-	//----------------------------------------------------------------
-	//	BODY
-	//----------------------------------------------------------------
-
-	//For: each DC motor channel
-	for (t = 0;t < DC_MOTOR_NUM;t++)
+	//if: the motors are to be cut
+	if (uart_timeout_cnt >= com_timeout.stop)
 	{
-		//Fetch current settings
-		target_speed = dc_motor_target[t];
-		actual_speed = dc_motor[t];
-		
-		//If directions are different
-		if (target_speed.f_dir != actual_speed.f_dir)
-		{
-			//if pwm is above slew rate
-			if (actual_speed.pwm > DC_MOTOR_SLEW_RATE)
-			{
-				//Slow down by the slew rate
-				actual_speed.pwm -= DC_MOTOR_SLEW_RATE;
-			}
-			//if pwm is below or at slew rate
-			else
-			{
-				//Set neutral speed
-				actual_speed.pwm = 0;
-			}
-			//if pwm is zero
-			if (actual_speed.pwm == 0)
-			{
-				//I'm authorized to change direction
-				actual_speed.f_dir = target_speed.f_dir;
-			}
-		}	//End If directions are different
-		//if direction is the same
-		else
-		{
-			//if pwm is above target
-			if (actual_speed.pwm > target_speed.pwm)
-			{
-				//Decrease speed by PWM
-				actual_speed.pwm = AT_SAT_SUM( actual_speed.pwm, -DC_MOTOR_SLEW_RATE, DC_MOTOR_MAX_PWM, 0 );
-				//if: overshoot
-				if (actual_speed.pwm < target_speed.pwm)
-				{
-					//I reached the target
-					actual_speed.pwm = target_speed.pwm;
-				}
-			}
-			//if pwm is below target
-			else if (actual_speed.pwm < target_speed.pwm)
-			{
-				//Decrease speed by PWM
-				actual_speed.pwm = AT_SAT_SUM( actual_speed.pwm, +DC_MOTOR_SLEW_RATE, DC_MOTOR_MAX_PWM, 0 );
-				//if: overshoot
-				if (actual_speed.pwm > target_speed.pwm)
-				{
-					//I reached the target
-					actual_speed.pwm = target_speed.pwm;
-				}
-			}
-			//if: I'm already at the right speed
-			else
-			{
-				//do nothing
-			}
-		}
-		
-		//Apply setting
-		set_vnh7040_speed( t, actual_speed.f_dir, actual_speed.pwm );
-		
-		//Write back setting
-		dc_motor[t] = actual_speed;
-	}	//End For: each DC motor channel
+		com_timeout.tier = COM_TIER_STOP;
+	}
+	else if (uart_timeout_cnt >= com_timeout.decel)
+	{
+		com_timeout.tier = COM_TIER_DECEL;
+	}
+	else if (uart_timeout_cnt >= com_timeout.hold)
+	{
+		com_timeout.tier = COM_TIER_HOLD;
+	}
+	else
+	{
+		com_timeout.tier = COM_TIER_OK;
+	}
+	//if: the link moved to another tier
+	if (com_timeout.tier != tier_old)
+	{
+		TRACE_POINT( TRACE_COM_TIER, com_timeout.tier );
+	}
+	//This is the only code allowed to raise and reset the timeout flag
+	f_timeout_detected = (com_timeout.tier == COM_TIER_STOP);
 
 	//----------------------------------------------------------------
 	//	RETURN
 	//----------------------------------------------------------------
 
-	return; //OK
-}	//end handler: signature_handler | void
+	return;
+}	//end task: timeout_task | void
 
 /***************************************************************************/
 //!	@brief ping command handler
@@ -726,23 +971,53 @@ void ping_handler( void )
 	return; //OK
 }	//end handler: ping_handler | void
 
+/****************************************************************************
+**  Function
+**  signature_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param arg		| unused
+//! @param payload	| output. BOARD_SIGN_LEN bytes
+//! @return uint8_t | length of the signature
+//! @brief Build the board signature reply. Plain text, no terminator
+/***************************************************************************/
+
+uint8_t signature_reply( uint8_t arg, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	(void)arg;
+	//For: each signature byte
+	for (t = 0;t < BOARD_SIGN_LEN;t++)
+	{
+		payload[t] = board_sign[t];
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return BOARD_SIGN_LEN;
+}	//End: signature_reply
+
 /***************************************************************************/
 //!	@brief board signature handler
 //!	signature_handler | void
 /***************************************************************************/
 //! @return void
 //!	@details
-//! Handler for the get board signature command. Send board signature via UART
+//! Handler for the get board signature command. Send board signature via UART, see signature_reply
 /***************************************************************************/
 
 void signature_handler( void )
 {
-	//----------------------------------------------------------------
-	//	VARS
-	//----------------------------------------------------------------
-
-	uint8_t t;
-
 	//----------------------------------------------------------------
 	//	INIT
 	//----------------------------------------------------------------
@@ -754,14 +1029,8 @@ void signature_handler( void )
 	//	BODY
 	//----------------------------------------------------------------
 
-	//Init while
-	t = 0;
-	//while: no termination and tx buffer width is not exceeded
-	while ((t < RPI_TX_BUF_SIZE) && (board_sign[t]!= '\0'))
-	{
-		//Send the next signature byte
-		AT_BUF_PUSH(rpi_tx_buf, board_sign[t]);
-	}
+	//Answer on the port that asked, whole, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_SIGN, 0 );
 
 	//----------------------------------------------------------------
 	//	RETURN
@@ -775,10 +1044,12 @@ void signature_handler( void )
 //!	set_speed_handler | int16_t, int16_t
 /***************************************************************************/
 //! @param motor_index | index of the motor being controlled
-//! @param pwm | new PWM setting of the motor
+//! @param pwm | new PWM setting of the motor. Negative sets f_dir. No layout correction
 //! @return false: OK | true: fail
 //!	@details
 //! Handler for the motor speed set command. It's going to be called automatically when command is received
+//! Sets the target of one channel, open loop. update_pwm drives the channel through the ramp,
+//! the current limit and the communication timeout like the platform commands
 /***************************************************************************/
 
 void set_speed_handler( int16_t motor_index, int16_t pwm )
@@ -787,8 +1058,8 @@ void set_speed_handler( int16_t motor_index, int16_t pwm )
 	//	VARS
 	//----------------------------------------------------------------
 
-	bool f_dir;
-	uint8_t tcb_pwm;
+	//duty. Q8 PWM
+	int32_t duty;
 
 	//----------------------------------------------------------------
 	//	INIT
@@ -796,32 +1067,131 @@ void set_speed_handler( int16_t motor_index, int16_t pwm )
 
 	//Reset communication timeout handler
 	uart_timeout_cnt = 0;
+	//if: Driver index not installed.
+	if ((motor_index < 0) || (motor_index >= DC_MOTOR_NUM))
+	{
+		//Do nothing
+		return;
+	}
 
 	//----------------------------------------------------------------
 	//	BODY
 	//----------------------------------------------------------------
 
-	if (pwm < 0)
+	//Open loop. The velocity loops would overwrite the target
+	f_speed_ctrl = false;
+	duty = (int32_t)pwm << 8;
+	duty = AT_SAT( duty, (int32_t)DC_MOTOR_MAX_DUTY, -(int32_t)DC_MOTOR_MAX_DUTY );
+	dc_motor_target.pwm[motor_index] = (duty < 0)?(-duty):(duty);
+	dc_motor_target.f_dir[motor_index] = (duty < 0);
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: set_speed_handler | void
+
+/***************************************************************************/
+//!	@brief set stop and reversal modes of the DC motors
+//!	stop_mode_handler | uint8_t, uint8_t, uint8_t, uint8_t
+/***************************************************************************/
+//! @param index		| motor. Out of range = all the motors
+//! @param stop_mode	| MOTOR_STOP_RAMP | MOTOR_STOP_COAST | MOTOR_STOP_BRAKE
+//! @param reverse_mode	| MOTOR_REVERSE_RAMP | MOTOR_REVERSE_BRAKE
+//! @param brake_pwm	| PWM of the active brake. Clipped to DC_MOTOR_MAX_PWM
+//! @return void
+//!	@details
+//! Handler for the stop and reversal mode command. Unknown modes are ignored
+/***************************************************************************/
+
+void stop_mode_handler( uint8_t index, uint8_t stop_mode, uint8_t reverse_mode, uint8_t brake_pwm )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: unknown mode
+	if ((stop_mode > MOTOR_STOP_BRAKE) || (reverse_mode > MOTOR_REVERSE_BRAKE))
 	{
-		f_dir = true;
-		pwm = -pwm;
+		return;
 	}
-	else
+	brake_pwm = (brake_pwm > DC_MOTOR_MAX_PWM)?(DC_MOTOR_MAX_PWM):(brake_pwm);
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
 	{
-		f_dir = false;
+		//if: not the selected motor
+		if ((index < DC_MOTOR_NUM) && (index != t))
+		{
+			continue;
+		}
+		motor_stop.stop_mode[t] = stop_mode;
+		motor_stop.reverse_mode[t] = reverse_mode;
+		motor_stop.brake_pwm[t] = brake_pwm;
 	}
-	
-	tcb_pwm = pwm;
 
-	//Set direction and speed setting of the VNH7040 controlled motor
-	set_vnh7040_speed( motor_index, f_dir, tcb_pwm );
-	
 	//----------------------------------------------------------------
 	//	RETURN
 	//----------------------------------------------------------------
 
 	return; //OK
-}	//end handler: set_speed_handler | void
+}	//end handler: stop_mode_handler | uint8_t, uint8_t, uint8_t, uint8_t
+
+/***************************************************************************/
+//!	@brief set the tiers of the communication timeout
+//!	com_timeout_handler | uint8_t, uint8_t, uint8_t
+/***************************************************************************/
+//! @param hold		| silence before the last setpoint is held. timeout_task periods
+//! @param decel	| silence before the motors ramp down. timeout_task periods
+//! @param stop		| silence before the motors are cut. timeout_task periods
+//! @return void
+//!	@details
+//! Handler for the communication timeout command. The tiers must be in order and stop
+//! can't be zero, otherwise the command is ignored. Equal values skip a tier
+/***************************************************************************/
+
+void com_timeout_handler( uint8_t hold, uint8_t decel, uint8_t stop )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: tiers out of order
+	if ((stop == 0) || (hold > decel) || (decel > stop))
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	com_timeout.hold = hold;
+	com_timeout.decel = decel;
+	com_timeout.stop = stop;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: com_timeout_handler | uint8_t, uint8_t, uint8_t
 
 /***************************************************************************/
 //!	@brief set the target speed of the DC motors
@@ -831,7 +1201,8 @@ void set_speed_handler( int16_t motor_index, int16_t pwm )
 //! @param pwm_l | pwm for left side of platform
 //! @return false: OK | true: fail
 //!	@details
-//! Handler for the platform speed. Firmware handles logical configuration of the motors. TODO: evolve to forward and turn
+//! Handler for the platform speed. Firmware handles logical configuration of the motors.
+//! Forward and turn are handled by the platform twist commands, see kinematics.cpp
 //! Numeration is handled like an IC with dot on the back, viewing from the top
 //! Direction is corrected so that plus is forward
 //!			Left	Right
@@ -841,13 +1212,6 @@ void set_speed_handler( int16_t motor_index, int16_t pwm )
 
 void set_platform_speed_handler(int16_t right, int16_t left )
 {
-	//----------------------------------------------------------------
-	//	VARS
-	//----------------------------------------------------------------
-
-	uint8_t f_dir_r, f_dir_l;
-	uint8_t tcb_pwm_l, tcb_pwm_r;
-
 	//----------------------------------------------------------------
 	//	INIT
 	//----------------------------------------------------------------
@@ -859,46 +1223,9 @@ void set_platform_speed_handler(int16_t right, int16_t left )
 	//	BODY
 	//----------------------------------------------------------------
 
-		//----------------------------------------------------------------
-		//	MOTORS LAYOUT CORRECTIONS
-		//----------------------------------------------------------------
+	//Layout corrections and open loop. update_pwm will take care of trying to reach the desired setting
+	set_platform_pwm( (int32_t)right << 8, (int32_t)left << 8 );
 
-	if (right < 0)
-	{
-		f_dir_r = false;
-		tcb_pwm_r = -right;
-	}
-	else
-	{
-		f_dir_r = true;
-		tcb_pwm_r = right;
-	}
-	
-	if (left < 0)
-	{
-		f_dir_l = true;
-		tcb_pwm_l = -left;
-	}
-	else
-	{
-		f_dir_l = false;
-		tcb_pwm_l = left;
-	}
-	
-		//----------------------------------------------------------------
-		//	UPDATE TARGET PWM AND DIRECTION
-		//----------------------------------------------------------------
-		//	upgrade_pwm will take caare of trying to reach the desired setting
-
-	dc_motor_target[0].f_dir = 	f_dir_r;
-	dc_motor_target[0].pwm = 	tcb_pwm_r;
-	dc_motor_target[1].f_dir = 	f_dir_r;
-	dc_motor_target[1].pwm = 	tcb_pwm_r;
-	dc_motor_target[2].f_dir = 	f_dir_l;
-	dc_motor_target[2].pwm = 	tcb_pwm_l;
-	dc_motor_target[3].f_dir = 	f_dir_l;
-	dc_motor_target[3].pwm = 	tcb_pwm_l;
-	
 	//----------------------------------------------------------------
 	//	RETURN
 	//----------------------------------------------------------------
@@ -0,0 +1,195 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	PROFILER
+*****************************************************************
+**	Section profiler. Compiled out unless ENABLE_PROFILE is defined
+**	in profile.h
+**	On the AT4809 the timebase is the TCA0 counter, 200ns per count.
+**	Host builds use std::chrono in the same unit so that the numbers
+**	of both sides can be compared.
+**
+**		PROFILE FRAME 'P' (see telemetry.cpp for the frame format)
+**	| ID | NUM L | NUM H | MIN L | MIN H | MAX L | MAX H | AVG L | AVG H |
+**	Times are in profiler counts
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+#ifdef ENABLE_PROFILE
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Statistics of the profiled sections
+Profile_stats g_profile[ PROFILE_NUM ];
+
+/****************************************************************************
+**  Function
+**  init_profile
+****************************************************************************/
+//! @return void |
+//! @brief Clear the statistics of all the sections
+/***************************************************************************/
+
+void init_profile( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each section
+	for (t = 0;t < PROFILE_NUM;t++)
+	{
+		g_profile[t].num = 0;
+		g_profile[t].min = UINT16_MAX;
+		g_profile[t].max = 0;
+		g_profile[t].sum = 0;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_profile
+
+/****************************************************************************
+**  Function
+**  profile_record | uint8_t, uint16_t
+****************************************************************************/
+//! @param id		| profiled section
+//! @param elapsed	| time spent in the section in profiler counts
+//! @return void |
+//! @brief Add a sample to the statistics of a section
+//! @details When the number of samples saturates, samples and sum are halved. The average is kept
+/***************************************************************************/
+
+void profile_record( uint8_t id, uint16_t elapsed )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	Profile_stats &stats = g_profile[id];
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: number of samples is about to saturate
+	if (stats.num == UINT16_MAX)
+	{
+		stats.num >>= 1;
+		stats.sum >>= 1;
+	}
+	stats.num++;
+	stats.sum += elapsed;
+	stats.min = (elapsed < stats.min)?(elapsed):(stats.min);
+	stats.max = (elapsed > stats.max)?(elapsed):(stats.max);
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: profile_record
+
+/****************************************************************************
+**  Function
+**  profile_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param id		| profiled section. Checked by the handler
+//! @param payload	| output. TELEMETRY_PROFILE_LEN bytes
+//! @return uint8_t | payload length
+//! @brief Build the payload of the profile frame
+//! @details | ID | NUM L | NUM H | MIN L | MIN H | MAX L | MAX H | AVG L | AVG H |
+/***************************************************************************/
+
+uint8_t profile_reply( uint8_t id, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//payload index
+	uint8_t i;
+	//average time
+	uint16_t avg;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	Profile_stats &stats = g_profile[id];
+	avg = (stats.num == 0)?(0):((uint16_t)(stats.sum /stats.num));
+	i = 0;
+	payload[i++] = id;
+	payload[i++] = U16L( stats.num );
+	payload[i++] = U16H( stats.num );
+	payload[i++] = U16L( stats.min );
+	payload[i++] = U16H( stats.min );
+	payload[i++] = U16L( stats.max );
+	payload[i++] = U16H( stats.max );
+	payload[i++] = U16L( avg );
+	payload[i++] = U16H( avg );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return i;
+}	//End: profile_reply
+
+/***************************************************************************/
+//!	@brief profiler dump handler
+//!	profile_handler | uint8_t
+/***************************************************************************/
+//! @param id | profiled section to be dumped
+//! @return void
+//!	@details
+//! Handler for the profiler dump command. Answers with a profile frame, see profile_reply.
+//!	Out of range sections are ignored
+/***************************************************************************/
+
+void profile_handler( uint8_t id )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: there is no such section
+	if (id >= PROFILE_NUM)
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Answer on the port that asked, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_PROFILE, id );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: profile_handler | uint8_t
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef PROFILE_H
+	#define PROFILE_H
+
+	/**********************************************************************************
+	**	ENVIROMENT VARIABILE
+	**********************************************************************************/
+
+	//#define ENABLE_PROFILE
+
+	/**********************************************************************************
+	**	GLOBAL INCLUDE
+	**********************************************************************************/
+
+	//type definition using the bit width and signedness
+	#include <stdint.h>
+
+	#ifdef ENABLE_PROFILE
+		#ifdef __AVR__
+			//TCA0 counter is the timebase
+			#include <avr/io.h>
+		#else
+			//Host builds use the monotonic clock of the OS
+			#include <chrono>
+		#endif
+	#endif
+
+	/**********************************************************************************
+	**	DEFINE
+	**********************************************************************************/
+	//	Profiled sections. Add an index before PROFILE_NUM to profile a new section
+
+	//Slew rate limiter and PWM update
+	#define PROFILE_UPDATE_PWM		0
+	//Parser. One RX byte
+	#define PROFILE_PARSER_EXE		1
+	//TX drain. One TX byte
+	#define PROFILE_UART_TX			2
+	//Number of profiled sections
+	#define PROFILE_NUM				3
+
+	//Length of a profiler count in ns. TCA0 runs at 20MHz/4. Host builds use the same unit
+	//global.h checks it against the prescaler chosen by the PWM carrier solver
+	#define PROFILE_NS_PER_CNT		200
+
+	/**********************************************************************************
+	**	MACRO
+	**********************************************************************************/
+	//	A section is timed from PROFILE_START to PROFILE_STOP in the same scope,
+	//	or from PROFILE_SCOPE to the end of the scope, whatever return is taken.
+	//	Sections must be shorter than 65535 counts, 13.1ms.
+	//	Don't use them inside ISRs, a 16bit read of TCA0 in an ISR corrupts the one in the main loop
+
+	#ifdef ENABLE_PROFILE
+
+		//Start timing a section
+		#define PROFILE_START( id )	\
+			uint16_t _profile_start_##id = profile_timestamp()
+
+		//Stop timing a section and update its statistics
+		#define PROFILE_STOP( id )	\
+			profile_record( (id), profile_timestamp() -_profile_start_##id )
+
+		//Time a section until the end of the scope
+		#define PROFILE_SCOPE( id )	\
+			Profile_scope _profile_scope_##id( (id) )
+
+	#else
+
+		#define PROFILE_START( ... )
+
+		#define PROFILE_STOP( ... )
+
+		#define PROFILE_SCOPE( ... )
+
+	#endif
+
+	/**********************************************************************************
+	**	TYPEDEF
+	**********************************************************************************/
+
+	#ifdef ENABLE_PROFILE
+
+	//Statistics of a profiled section
+	typedef struct _Profile_stats Profile_stats;
+
+	/**********************************************************************************
+	**	PROTOTYPE: STRUCTURE
+	**********************************************************************************/
+
+	//Statistics of a profiled section. Times in profiler counts
+	struct _Profile_stats
+	{
+		uint16_t num;			//Number of samples. Halved together with sum when it saturates
+		uint16_t min;			//Minimum time
+		uint16_t max;			//Maximum time
+		uint32_t sum;			//Sum of the times. Average is sum /num
+	};
+
+	/**********************************************************************************
+	**	PROTOTYPE: GLOBAL VARIABILE
+	**********************************************************************************/
+
+	//Statistics of the profiled sections
+	extern Profile_stats g_profile[ PROFILE_NUM ];
+
+	/**********************************************************************************
+	**	PROTOTYPE: FUNCTION
+	**********************************************************************************/
+
+	//Clear the statistics of all the sections
+	extern void init_profile( void );
+	//Add a sample to the statistics of a section
+	extern void profile_record( uint8_t id, uint16_t elapsed );
+	//Build the payload of the profile frame. Returns the payload length
+	extern uint8_t profile_reply( uint8_t id, uint8_t *payload );
+	//Handler for the profiler dump command
+	extern void profile_handler( uint8_t id );
+
+	//Read the profiler timebase
+	inline uint16_t profile_timestamp( void )
+	{
+		#ifdef __AVR__
+			return TCA0.SINGLE.CNT;
+		#else
+			return (uint16_t)(std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() /PROFILE_NS_PER_CNT);
+		#endif
+	}
+
+	//Time a section from construction to destruction
+	class Profile_scope
+	{
+		public:
+			Profile_scope( uint8_t id ) : g_id( id ), g_start( profile_timestamp() )
+			{
+			}
+			~Profile_scope( void )
+			{
+				profile_record( g_id, profile_timestamp() -g_start );
+			}
+		private:
+			uint8_t g_id;
+			uint16_t g_start;
+	};
+
+	#endif
+
+#else
+	#warning "multiple inclusion of the header file"
+#endif
@@ -0,0 +1,385 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	PWM CHECK
+*****************************************************************
+**	Host builds only. Compiled out unless ENABLE_PWM_CHECK is
+**	defined in global.h
+**	Checks update_pwm against the implementation it replaced, on
+**	whatever command stream the host build is fed:
+**	RAMP	: every trajectory_step is compared with trajectory_step_ref,
+**			the branchy version that preceded the saturating one.
+**			Output and rate must be bit exact
+**	DRIVERS	: update_pwm writes a driver only when its setting changes.
+**			After each call, pins and timers of every driver must be
+**			what a write of all the channels leaves, which is what
+**			update_pwm did every tick before
+**	Mismatches are printed on stderr as they happen. At exit the
+**	number of checks and mismatches is printed with the average
+**	host time of the two ramps and of a write of all the drivers.
+**
+**		USAGE
+**	g++ -std=c++11 -O2 -DENABLE_PWM_CHECK $(ls *.cpp | grep -v trace_decode) -o orangebot -pthread
+**	./orangebot < commands > /dev/null
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+#ifdef ENABLE_PWM_CHECK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+/****************************************************************
+**	DEFINES
+****************************************************************/
+
+//All the drivers
+#define PWM_CHECK_ALL		(MASK( DC_MOTOR_NUM ) -1)
+
+/****************************************************************
+** FUNCTION PROTOTYPES
+****************************************************************/
+
+//Apply the current setting of the selected motors to the VNH7040 drivers. See main.cpp
+extern void apply_vnh7040( uint8_t mask );
+
+/****************************************************************
+**	STRUCTURES
+****************************************************************/
+
+//Ramp generator of one motor, as it was before the struct of arrays
+typedef struct _Pwm_check_ramp
+{
+	int32_t value;		//Output PWM
+	int32_t rate;		//Change of the output in the last tick
+	uint16_t accel;		//Maximum change per tick while the magnitude grows
+	uint16_t decel;		//Maximum change per tick while the magnitude shrinks
+	uint16_t jerk;		//Maximum change of the rate per tick. 0 = linear ramps
+} Pwm_check_ramp;
+
+//What a driver is driving
+typedef struct _Pwm_check_driver
+{
+	uint8_t pins;		//INA and INB
+	uint8_t base;		//Integer part of the duty
+	uint8_t frac;		//Fraction of the duty
+	uint8_t cmp;		//Compare of the timer. Only checked without a fraction, the dither ISR moves it
+} Pwm_check_driver;
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Number of ramp steps and of update_pwm calls checked
+static uint32_t g_check_ramp_num = 0;
+static uint32_t g_check_drv_num = 0;
+//Number of mismatches
+static uint32_t g_check_ramp_err = 0;
+static uint32_t g_check_drv_err = 0;
+//update_pwm calls that wrote a driver
+static uint32_t g_check_drv_write = 0;
+//Time spent by trajectory_step, trajectory_step_ref and the writes of all the drivers. ns
+static uint64_t g_check_ramp_ns = 0;
+static uint64_t g_check_ref_ns = 0;
+static uint64_t g_check_all_ns = 0;
+
+/****************************************************************************
+**  Function
+**  pwm_check_ns
+****************************************************************************/
+//! @return uint64_t | host monotonic clock. ns
+/***************************************************************************/
+
+static uint64_t pwm_check_ns( void )
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}	//End: pwm_check_ns
+
+/****************************************************************************
+**  Function
+**  pwm_check_report
+****************************************************************************/
+//! @return void |
+//! @brief Print the totals. Runs at exit
+/***************************************************************************/
+
+static void pwm_check_report( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	fprintf( stderr, "pwm_check: ramp %u steps %u mismatches | %.1fns new %.1fns ref\n",
+		(unsigned)g_check_ramp_num, (unsigned)g_check_ramp_err,
+		(g_check_ramp_num > 0)?((double)g_check_ramp_ns /g_check_ramp_num):(0.0),
+		(g_check_ramp_num > 0)?((double)g_check_ref_ns /g_check_ramp_num):(0.0) );
+	fprintf( stderr, "pwm_check: drivers %u ticks %u mismatches | written on %u ticks | write of all the drivers %.1fns\n",
+		(unsigned)g_check_drv_num, (unsigned)g_check_drv_err, (unsigned)g_check_drv_write,
+		(g_check_drv_num > 0)?((double)g_check_all_ns /g_check_drv_num):(0.0) );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: pwm_check_report
+
+/****************************************************************************
+**  Function
+**  trajectory_step_ref | Pwm_check_ramp &, int32_t
+****************************************************************************/
+//! @param traj		| ramp generator
+//! @param target	| target PWM. Q8 signed
+//! @return int32_t | output PWM. Q8 signed
+//! @brief trajectory_step as it was before the saturating arithmetic. Reference, don't optimize
+/***************************************************************************/
+
+static int32_t trajectory_step_ref( Pwm_check_ramp &traj, int32_t target )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//distance from the target
+	int32_t err = target -traj.value;
+	//distance from the target. Magnitude
+	int32_t dist;
+	//ramp toward the target. Negative if moving away from it
+	int32_t ramp;
+	//limit of the ramp
+	int32_t limit;
+	//change of the output
+	int32_t step;
+	//moving toward positive PWM
+	bool f_up;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//if: target reached
+	if (err == 0)
+	{
+		traj.rate = 0;
+		return traj.value;
+	}
+	f_up = (err > 0);
+	dist = (f_up == true)?(err):(-err);
+	//ACCEL if the magnitude grows, DECEL if it shrinks
+	limit = ((traj.value == 0) || ((traj.value > 0) == f_up))?(traj.accel):(traj.decel);
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: linear ramps
+	if (traj.jerk == 0)
+	{
+		step = (dist > limit)?(limit):(dist);
+	}
+	//if: S-curve
+	else
+	{
+		ramp = (f_up == true)?(traj.rate):(-traj.rate);
+		//if: moving away from the target or still far from the braking point
+		if ((ramp < 0) || (ramp *ramp < ((int32_t)2 *traj.jerk *dist)))
+		{
+			ramp += traj.jerk;
+			ramp = (ramp > limit)?(limit):(ramp);
+		}
+		//if: braking toward the target
+		else
+		{
+			//Never stop short of the target
+			ramp -= traj.jerk;
+			ramp = (ramp < (int32_t)traj.jerk)?((int32_t)traj.jerk):(ramp);
+			ramp = (ramp > limit)?(limit):(ramp);
+		}
+		//Land on the target
+		step = (ramp > dist)?(dist):(ramp);
+	}
+	step = (f_up == true)?(step):(-step);
+	//if: the step crosses zero. Stop there, the other side has a different limit
+	if (((traj.value > 0) && (traj.value +step < 0)) || ((traj.value < 0) && (traj.value +step > 0)))
+	{
+		step = -traj.value;
+	}
+	traj.value += step;
+	traj.rate = step;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return traj.value;
+}	//End: trajectory_step_ref
+
+/****************************************************************************
+**  Function
+**  pwm_check_read | Pwm_check_driver *
+****************************************************************************/
+//! @param drv	| output. What each driver is driving
+//! @return void |
+/***************************************************************************/
+
+static void pwm_check_read( Pwm_check_driver *drv )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each driver
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		const Vnh7040_desc &desc = vnh7040_desc[t];
+		drv[t].pins = desc.port -> OUT & (desc.ina_mask | desc.inb_mask);
+		drv[t].base = g_pwm_base[t];
+		drv[t].frac = g_pwm_frac[t];
+		drv[t].cmp = (g_pwm_frac[t] == 0)?(desc.pwm_timer -> CCMPH):(0);
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: pwm_check_read
+
+/****************************************************************************
+**  Function
+**  pwm_check_ramp | uint8_t, int32_t
+****************************************************************************/
+//! @param index	| index of the motor
+//! @param target	| target PWM. Q8 signed
+//! @return int32_t | output PWM of trajectory_step. Q8 signed
+//! @brief Advance the ramp generator of a motor with trajectory_step and check it against the reference
+/***************************************************************************/
+
+int32_t pwm_check_ramp( uint8_t index, int32_t target )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//the same ramp, for the reference
+	Pwm_check_ramp ref =
+	{
+		trajectory.value[index], trajectory.rate[index],
+		trajectory.accel[index], trajectory.decel[index], trajectory.jerk[index]
+	};
+	//output of the ramp
+	int32_t value;
+	//timestamp
+	uint64_t start;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	if ((g_check_ramp_num == 0) && (g_check_drv_num == 0))
+	{
+		atexit( pwm_check_report );
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	start = pwm_check_ns();
+	value = trajectory_step( index, target );
+	g_check_ramp_ns += pwm_check_ns() -start;
+	start = pwm_check_ns();
+	trajectory_step_ref( ref, target );
+	g_check_ref_ns += pwm_check_ns() -start;
+	g_check_ramp_num++;
+	//if: the saturating ramp went somewhere else
+	if ((ref.value != value) || (ref.rate != trajectory.rate[index]))
+	{
+		g_check_ramp_err++;
+		fprintf( stderr, "pwm_check: ramp %u target %d | value %d rate %d | ref %d %d\n",
+			index, (int)target, (int)value, (int)trajectory.rate[index], (int)ref.value, (int)ref.rate );
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return value;
+}	//End: pwm_check_ramp
+
+/****************************************************************************
+**  Function
+**  pwm_check_drivers | uint8_t
+****************************************************************************/
+//! @param change	| drivers written by update_pwm
+//! @return void |
+//! @brief Check that the drivers are what a write of all the channels leaves. Call at the end of update_pwm
+//! @details The write of all the channels is done for real. It fixes a mismatch, so each one is reported once
+/***************************************************************************/
+
+void pwm_check_drivers( uint8_t change )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//drivers after update_pwm and after a write of all of them
+	Pwm_check_driver drv[DC_MOTOR_NUM], drv_all[DC_MOTOR_NUM];
+	//timestamp
+	uint64_t start;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	if ((g_check_ramp_num == 0) && (g_check_drv_num == 0))
+	{
+		atexit( pwm_check_report );
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	pwm_check_read( drv );
+	start = pwm_check_ns();
+	apply_vnh7040( PWM_CHECK_ALL );
+	g_check_all_ns += pwm_check_ns() -start;
+	pwm_check_read( drv_all );
+	g_check_drv_num++;
+	g_check_drv_write += (change != 0);
+	//For: each driver
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		if ((drv[t].pins != drv_all[t].pins) || (drv[t].base != drv_all[t].base) || (drv[t].frac != drv_all[t].frac) || (drv[t].cmp != drv_all[t].cmp))
+		{
+			g_check_drv_err++;
+			fprintf( stderr, "pwm_check: driver %u tick %u | pins 0x%02x base %u frac %u cmp %u | all 0x%02x %u %u %u\n",
+				t, (unsigned)g_check_drv_num, drv[t].pins, drv[t].base, drv[t].frac, drv[t].cmp,
+				drv_all[t].pins, drv_all[t].base, drv_all[t].frac, drv_all[t].cmp );
+		}
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: pwm_check_drivers
+
+#endif
@@ -0,0 +1,647 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	SCHEDULER
+*****************************************************************
+**	Cooperative scheduler driven by the system tick.
+**	Tasks are listed in a static table owned by main.cpp.
+**	Each task has a period and a phase in system ticks and a priority.
+**	Tasks due on the same tick run in increasing priority value.
+**	Tasks with the same period but different phases never share a tick,
+**	use the phase to keep the heavy tasks apart.
+**
+**		STATISTICS
+**	Tasks are timed with the TCA0 counter, which also clocks the PWM
+**	One count is 200ns, a system tick is about 9766 counts.
+**	The counter wraps every 13.1ms, longer times are not told apart
+**	LATENCY		: from the RTC PIT ISR to the start of the task
+**	EXECUTION	: from the start to the end of the task
+**	Jitter of a task is its maximum latency minus its minimum latency
+**	The tick statistics use the RTC counter, 30.5us, which doesn't wrap
+**	before the watchdog bites
+**
+**		SYSTEM TICK OVERRUN
+**	The RTC PIT ISR counts the system ticks. If the main loop is late
+**	by more than one tick, the missed ticks are executed back to back
+**	so that the slew rate limiter and the timeouts keep their time.
+**	At most SCHED_MAX_CATCHUP ticks are executed in a single pass,
+**	the older ones are dropped and counted as lost.
+**	The ISR counter is 8bit, a stall of 256 ticks (0.5s) goes unnoticed
+**
+**		IDLE
+**	When no tick is pending and the USART ports have nothing to do,
+**	the main loop sleeps in IDLE mode until the next interrupt.
+**	The time spent sleeping is accumulated in RTC counts, idle_task
+**	turns it into a percentage of the window. Sleeps shorter than
+**	an RTC count are truncated, but they average out
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+#ifdef __AVR__
+	//SLEEP instruction
+	#include <avr/sleep.h>
+#endif
+
+/****************************************************************
+** FUNCTION PROTOTYPES
+****************************************************************/
+
+//Run the tasks due on a system tick and update their statistics
+extern void scheduler_tick( uint16_t tick_tca );
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//RTC counter sampled by the RTC PIT ISR on the last system tick
+volatile uint16_t g_tick_timestamp = 0;
+//TCA0 counter sampled by the RTC PIT ISR on the last system tick
+volatile uint16_t g_tick_tca = 0;
+//Task table, sorted by priority
+Task *g_task = nullptr;
+//Number of tasks inside the table
+uint8_t g_task_num = 0;
+
+	///--------------------------------------------------------------------------
+	///	SYSTEM TICK STATISTICS
+	///--------------------------------------------------------------------------
+
+//System ticks served by the main loop. Chases g_isr_flags.tick_cnt
+uint8_t g_tick_done = 0;
+//Passes that found more than one system tick pending
+uint16_t g_tick_overrun_cnt = 0;
+//System ticks dropped because the backlog exceeded SCHED_MAX_CATCHUP
+uint16_t g_tick_lost_cnt = 0;
+//Maximum number of system ticks found pending
+uint8_t g_tick_backlog_max = 0;
+//Maximum RTC counts from a system tick to the end of its tasks
+uint16_t g_loop_latency_max = 0;
+
+	///--------------------------------------------------------------------------
+	///	IDLE STATISTICS
+	///--------------------------------------------------------------------------
+
+//RTC counts spent sleeping in the current window
+uint16_t g_idle_acc = 0;
+//RTC counter at the start of the current window
+uint16_t g_idle_timestamp = 0;
+//Idle time percentage of the last window
+uint8_t g_idle_percent = 0;
+//Minimum idle time percentage. Worst case headroom
+uint8_t g_idle_percent_min = 100;
+
+/****************************************************************************
+**  Function
+**  init_scheduler | Task *, uint8_t
+****************************************************************************/
+//! @param table	| task table
+//! @param num		| number of tasks inside the table
+//! @return void |
+//! @brief Initialize the scheduler
+//! @details Sort the table by priority, load the phases and clear the statistics
+/***************************************************************************/
+
+void init_scheduler( Task *table, uint8_t num )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counters
+	uint8_t t, ti;
+	//task being moved
+	Task task_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	g_task = table;
+	g_task_num = num;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Insertion sort. Stable, tasks with the same priority keep the order of the table
+	for (t = 1;t < num;t++)
+	{
+		task_tmp = table[t];
+		ti = t;
+		while ((ti > 0) && (table[ti -1].priority > task_tmp.priority))
+		{
+			table[ti] = table[ti -1];
+			ti--;
+		}
+		table[ti] = task_tmp;
+	}
+
+	//For: each task
+	for (t = 0;t < num;t++)
+	{
+		//First execution after phase ticks
+		table[t].cnt = table[t].phase;
+		table[t].stats.num_exe = 0;
+		table[t].stats.exe_min = UINT16_MAX;
+		table[t].stats.exe_max = 0;
+		table[t].stats.lat_min = UINT16_MAX;
+		table[t].stats.lat_max = 0;
+	}
+	//Start the first idle window
+	g_idle_acc = 0;
+	g_idle_timestamp = atomic_read_u16( RTC.CNT );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_scheduler
+
+/****************************************************************************
+**  Function
+**  scheduler_service
+****************************************************************************/
+//! @return void |
+//! @brief Run the tasks of the system ticks elapsed since the last call
+//! @details Called by the main loop at every pass.
+//!	Late ticks are executed back to back, up to SCHED_MAX_CATCHUP per pass
+/***************************************************************************/
+
+void scheduler_service( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//system ticks pending
+	uint8_t pending;
+	//RTC counter at the system tick being served
+	uint16_t tick_timestamp;
+	//TCA0 counter at the system tick being served
+	uint16_t tick_tca;
+	//RTC counter at the oldest system tick pending
+	uint16_t oldest_timestamp;
+	//elapsed RTC counts
+	uint16_t delta;
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Counter and timestamp must belong to the same tick
+	sreg_tmp = SREG;
+	cli();
+	pending = g_isr_flags.tick_cnt -g_tick_done;
+	tick_timestamp = g_tick_timestamp;
+	tick_tca = g_tick_tca;
+	SREG = sreg_tmp;
+	//if: no system tick elapsed
+	if (pending == 0)
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: the main loop missed at least a tick
+	if (pending > 1)
+	{
+		g_tick_overrun_cnt++;
+		g_tick_backlog_max = (pending > g_tick_backlog_max)?(pending):(g_tick_backlog_max);
+	}
+	//if: the backlog is too long to be recovered
+	if (pending > SCHED_MAX_CATCHUP)
+	{
+		//Drop the oldest ticks. The system time still accounts for them
+		g_tick_lost_cnt += pending -SCHED_MAX_CATCHUP;
+		g_tick_cnt += pending -SCHED_MAX_CATCHUP;
+		g_tick_done += pending -SCHED_MAX_CATCHUP;
+		pending = SCHED_MAX_CATCHUP;
+	}
+	//Ticks are SCHED_RTC_CNT_PER_TICK apart
+	tick_timestamp -= (uint16_t)(pending -1) *SCHED_RTC_CNT_PER_TICK;
+	tick_tca -= (uint16_t)(pending -1) *SCHED_TCA_CNT_PER_TICK;
+	oldest_timestamp = tick_timestamp;
+	//While: system ticks pending. Oldest first
+	while (pending > 0)
+	{
+		//Timestamp for the telemetry
+		g_tick_cnt++;
+		g_tick_done++;
+		//Run the tasks due on this tick
+		scheduler_tick( tick_tca );
+		tick_timestamp += SCHED_RTC_CNT_PER_TICK;
+		tick_tca += SCHED_TCA_CNT_PER_TICK;
+		pending--;
+	}
+	//Heartbeat of the tick processing
+	WDT_BEAT( WDT_BEAT_TICK );
+	//Latency of the oldest tick served
+	delta = atomic_read_u16( RTC.CNT ) -oldest_timestamp;
+	g_loop_latency_max = (delta > g_loop_latency_max)?(delta):(g_loop_latency_max);
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: scheduler_service
+
+/****************************************************************************
+**  Function
+**  scheduler_tick | uint16_t
+****************************************************************************/
+//! @param tick_tca | TCA0 counter at the system tick
+//! @return void |
+//! @brief Run the tasks due on a system tick
+//! @details Tasks run to completion
+/***************************************************************************/
+
+void scheduler_tick( uint16_t tick_tca )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//TCA0 counter at the start and at the end of a task
+	uint16_t start_cnt, stop_cnt;
+	//elapsed TCA0 counts
+	uint16_t delta;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each task in priority order
+	for (t = 0;t < g_task_num;t++)
+	{
+		Task &task = g_task[t];
+		//if: task is disabled
+		if (task.period == 0)
+		{
+			continue;
+		}
+		//if: task is not due yet
+		if (task.cnt > 0)
+		{
+			task.cnt--;
+			continue;
+		}
+		task.cnt = task.period -1;
+
+		//The RTC PIT ISR restores the TEMP register of TCA0, the reads need no lock
+		start_cnt = TCA0.SINGLE.CNT;
+		//Run the task
+		task.handler();
+		stop_cnt = TCA0.SINGLE.CNT;
+
+			///Statistics
+		//Latency from the tick
+		delta = start_cnt -tick_tca;
+		task.stats.lat_min = (delta < task.stats.lat_min)?(delta):(task.stats.lat_min);
+		task.stats.lat_max = (delta > task.stats.lat_max)?(delta):(task.stats.lat_max);
+		//Execution time
+		delta = stop_cnt -start_cnt;
+		task.stats.exe_min = (delta < task.stats.exe_min)?(delta):(task.stats.exe_min);
+		task.stats.exe_max = (delta > task.stats.exe_max)?(delta):(task.stats.exe_max);
+		task.stats.num_exe++;
+	}	//End For: each task in priority order
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: scheduler_tick
+
+/****************************************************************************
+**  Function
+**  task_stats_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param index	| index of the task in priority order. Checked by the handler
+//! @param payload	| output. TELEMETRY_TASK_LEN bytes
+//! @return uint8_t | payload length
+//! @brief Build the payload of the task statistics frame
+//! @details
+//!	| INDEX | PERIOD | PHASE | PRIORITY | NUM EXE L | NUM EXE H | EXE MIN L | EXE MIN H | EXE MAX L | EXE MAX H | LAT MIN L | LAT MIN H | LAT MAX L | LAT MAX H |
+//!	Times are in TCA0 counts, 200ns
+/***************************************************************************/
+
+uint8_t task_stats_reply( uint8_t index, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//payload index
+	uint8_t i;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	Task &task = g_task[index];
+	i = 0;
+	payload[i++] = index;
+	payload[i++] = task.period;
+	payload[i++] = task.phase;
+	payload[i++] = task.priority;
+	payload[i++] = U16L( task.stats.num_exe );
+	payload[i++] = U16H( task.stats.num_exe );
+	payload[i++] = U16L( task.stats.exe_min );
+	payload[i++] = U16H( task.stats.exe_min );
+	payload[i++] = U16L( task.stats.exe_max );
+	payload[i++] = U16H( task.stats.exe_max );
+	payload[i++] = U16L( task.stats.lat_min );
+	payload[i++] = U16H( task.stats.lat_min );
+	payload[i++] = U16L( task.stats.lat_max );
+	payload[i++] = U16H( task.stats.lat_max );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return i;
+}	//End: task_stats_reply
+
+/***************************************************************************/
+//!	@brief task statistics query handler
+//!	task_stats_handler | uint8_t
+/***************************************************************************/
+//! @param index | index of the task in priority order
+//! @return void
+//!	@details
+//! Handler for the task statistics query. Answers with a task statistics frame, see task_stats_reply.
+//!	Out of range indexes are ignored
+/***************************************************************************/
+
+void task_stats_handler( uint8_t index )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: there is no such task
+	if (index >= g_task_num)
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Answer on the port that asked, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_TASK, index );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: task_stats_handler | uint8_t
+
+/****************************************************************************
+**  Function
+**  tick_stats_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param arg		| unused
+//! @param payload	| output. TELEMETRY_TICK_LEN bytes
+//! @return uint8_t | payload length
+//! @brief Build the payload of the system tick statistics frame
+//! @details
+//!	| OVERRUN L | OVERRUN H | LOST L | LOST H | BACKLOG MAX | LATENCY MAX L | LATENCY MAX H |
+//!	| IDLE | IDLE MIN |
+//!	Latency is in RTC counts. Above SCHED_RTC_CNT_PER_TICK the main loop is missing ticks
+//!	Idle is the percentage of time the CPU slept during the last window, and the minimum since boot
+/***************************************************************************/
+
+uint8_t tick_stats_reply( uint8_t arg, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//payload index
+	uint8_t i;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	(void)arg;
+	i = 0;
+	payload[i++] = U16L( g_tick_overrun_cnt );
+	payload[i++] = U16H( g_tick_overrun_cnt );
+	payload[i++] = U16L( g_tick_lost_cnt );
+	payload[i++] = U16H( g_tick_lost_cnt );
+	payload[i++] = g_tick_backlog_max;
+	payload[i++] = U16L( g_loop_latency_max );
+	payload[i++] = U16H( g_loop_latency_max );
+	payload[i++] = g_idle_percent;
+	payload[i++] = g_idle_percent_min;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return i;
+}	//End: tick_stats_reply
+
+/***************************************************************************/
+//!	@brief system tick statistics query handler
+//!	tick_stats_handler | void
+/***************************************************************************/
+//! @return void
+//!	@details
+//! Handler for the system tick statistics query. Answers with a system tick statistics frame, see tick_stats_reply
+/***************************************************************************/
+
+void tick_stats_handler( void )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Answer on the port that asked, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_TICK, 0 );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: tick_stats_handler | void
+
+/****************************************************************************
+**  Function
+**  scheduler_idle
+****************************************************************************/
+//! @return void |
+//! @brief Sleep until the next interrupt if there is no work pending
+//! @details Called by the main loop at every pass.
+//!	The check is done with interrupts disabled, and SEI delays the interrupts by one instruction,
+//!	so an interrupt that creates work can't slip in between the check and the SLEEP.
+//!	The RX ISR wakes up the CPU directly, sleeping adds no latency to the RX handling
+/***************************************************************************/
+
+void scheduler_idle( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//RTC counter when going to sleep
+	uint16_t sleep_cnt;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	cli();
+	//if: a system tick is pending or a port has work to do
+	if ((g_isr_flags.tick_cnt != g_tick_done) || (uart_port_arm_wakeup() == true))
+	{
+		sei();
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	sleep_cnt = RTC.CNT;
+	sei();
+	sleep_cpu();
+	//The ISR that woke up the CPU has already been served
+	g_idle_acc += atomic_read_u16( RTC.CNT ) -sleep_cnt;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: scheduler_idle
+
+/****************************************************************************
+**  Function
+**  scheduler_slack
+****************************************************************************/
+//! @return uint16_t | RTC counts left before the next system tick. 0 = the main loop is late
+//! @brief Time budget of a task that wants to finish before the next system tick
+//! @details Meant to be called by the tasks. A tick still pending leaves no slack
+/***************************************************************************/
+
+uint16_t scheduler_slack( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//ticks not served yet
+	uint8_t pending;
+	//timestamp of the last tick
+	uint16_t tick_timestamp;
+	//RTC counts since the last tick
+	uint16_t elapsed;
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Counter and timestamp must belong to the same tick
+	sreg_tmp = SREG;
+	cli();
+	pending = g_isr_flags.tick_cnt -g_tick_done;
+	tick_timestamp = g_tick_timestamp;
+	SREG = sreg_tmp;
+	//if: the main loop is behind
+	if (pending != 0)
+	{
+		return 0;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	elapsed = atomic_read_u16( RTC.CNT ) -tick_timestamp;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return (elapsed >= SCHED_RTC_CNT_PER_TICK)?(0):(SCHED_RTC_CNT_PER_TICK -elapsed);
+}	//End: scheduler_slack
+
+/****************************************************************************
+**  Function
+**  idle_task
+****************************************************************************/
+//! @return void |
+//! @brief Compute the idle time percentage over the last window
+//! @details Called by the scheduler. The window is the period of the task
+/***************************************************************************/
+
+void idle_task( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//RTC counter at the end of the window
+	uint16_t now_cnt = atomic_read_u16( RTC.CNT );
+	//length of the window in RTC counts
+	uint16_t window = now_cnt -g_idle_timestamp;
+	//idle percentage
+	uint16_t percent;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Start the next window
+	g_idle_timestamp = now_cnt;
+	//if: empty window
+	if (window == 0)
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	percent = (uint32_t)g_idle_acc *100 /window;
+	g_idle_acc = 0;
+	g_idle_percent = (percent > 100)?(100):((uint8_t)percent);
+	g_idle_percent_min = (g_idle_percent < g_idle_percent_min)?(g_idle_percent):(g_idle_percent_min);
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: idle_task
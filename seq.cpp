@@ -0,0 +1,244 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	SEQUENCE NUMBERS
+*****************************************************************
+**	Optional sequence numbers on the commands, answered with
+**	cumulative ACK/NAK frames.
+**
+**		PROTOCOL
+**	The RPI prefixes a command with SEQ%u, e.g.
+**	"SEQ12\0PWMR50L50\0"
+**	Commands without the prefix are fire and forget as before.
+**	Several numbered commands can be in flight at once.
+**	Replies are batched: at most one per port per system tick,
+**	carrying the state after all the commands decoded so far.
+**
+**		REPLY FRAME (see telemetry.cpp for the frame format)
+**	| ACK BASE | RX MASK |
+**	ACK BASE	: next sequence number expected. All previous ones have been applied
+**	RX MASK		: bit n = ACK BASE +1 +n was applied out of order
+**	'A' ACK		: nothing is missing
+**	'N' NAK		: ACK BASE is missing or a command failed to decode. Retransmit ACK BASE
+**				and the other numbers not in RX MASK, if they are still relevant
+**
+**		NOTES
+**	A numbered command is applied as soon as it's decoded, even out of order,
+**	so that a new setpoint isn't held back by a lost one.
+**	Duplicates are applied again. Setpoint commands are idempotent,
+**	the RPI should not retransmit a setpoint that has been superseded
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************************
+**  Function
+**  init_seq | Seq_status &
+****************************************************************************/
+//! @param seq | sequence number tracker
+//! @return void |
+//! @brief Reset the sequence number tracker of a port
+//! @details First sequence number expected is 0
+/***************************************************************************/
+
+void init_seq( Seq_status &seq )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	seq.ack_base = 0;
+	seq.rx_mask = 0;
+	seq.seq = 0;
+	seq.armed = SEQ_IDLE;
+	seq.f_reply = false;
+	seq.f_fail = false;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_seq
+
+/***************************************************************************/
+//!	@brief sequence number prefix handler
+//!	seq_handler | uint8_t
+/***************************************************************************/
+//! @param seq | sequence number of the next command
+//! @return void
+//!	@details
+//! Handler for the sequence number prefix. The number applies to the next command decoded on the same port
+/***************************************************************************/
+
+void seq_handler( uint8_t seq )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Store the sequence number. The terminator of this prefix is still to be accounted
+	g_uart_port_active -> seq.seq = seq;
+	g_uart_port_active -> seq.armed = SEQ_ARMED_NOW;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: seq_handler | uint8_t
+
+/****************************************************************************
+**  Function
+**  seq_command_done | Uart_port &, bool
+****************************************************************************/
+//! @param port			| port whose parser received the terminator
+//! @param f_executed	| true if the terminator executed a command
+//! @return void |
+//! @brief Account the command against the pending sequence number
+//! @details
+//!	Sequence numbers are compared modulo 256. Numbers from ACK BASE to ACK BASE +SEQ_WINDOW
+//!	are accepted, everything else is a duplicate or too far ahead and only triggers a new reply
+/***************************************************************************/
+
+void seq_command_done( Uart_port &port, bool f_executed )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	Seq_status &seq = port.seq;
+	//distance of the sequence number from ACK BASE
+	uint8_t offset;
+	//next sequence number had already been received
+	bool f_next;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//if: the terminator closed the SEQ prefix itself
+	if (seq.armed == SEQ_ARMED_NOW)
+	{
+		//The next command carries the number
+		seq.armed = SEQ_ARMED;
+		return;
+	}
+	//if: command has no sequence number
+	else if (seq.armed == SEQ_IDLE)
+	{
+		return;
+	}
+	//A number is consumed by one command only
+	seq.armed = SEQ_IDLE;
+	//Whatever happens, the RPI gets a reply
+	seq.f_reply = true;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: the command didn't decode
+	if (f_executed == false)
+	{
+		//Report a NAK. ACK BASE and RX MASK tell what is still missing
+		seq.f_fail = true;
+		return;
+	}
+
+	offset = seq.seq -seq.ack_base;
+	//if: it's the number I was waiting for
+	if (offset == 0)
+	{
+		//Advance ACK BASE past all the numbers already received out of order
+		do
+		{
+			f_next = IS_BIT_ONE( seq.rx_mask, 0 );
+			seq.rx_mask >>= 1;
+			seq.ack_base++;
+		}
+		while (f_next == true);
+	}
+	//if: it's ahead, inside the window
+	else if (offset <= SEQ_WINDOW)
+	{
+		//Remember it. The gap turns the reply into a NAK
+		SET_BIT( seq.rx_mask, offset -1 );
+	}
+	//if: duplicate or too far ahead
+	else
+	{
+		//Just answer with the current state
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: seq_command_done
+
+/****************************************************************************
+**  Function
+**  update_seq
+****************************************************************************/
+//! @return void |
+//! @brief Send the pending cumulative ACK/NAK of each port
+//! @details Called every system tick. A reply that doesn't fit the TX buffer is retried on the next tick
+/***************************************************************************/
+
+void update_seq( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//frame payload
+	uint8_t payload[ TELEMETRY_ACK_LEN ];
+	//frame type
+	uint8_t type;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each port
+	for (t = 0;t < UART_PORT_NUM;t++)
+	{
+		Uart_port &port = g_uart_port[t];
+		//if: no reply is due
+		if ((port.usart == nullptr) || (port.seq.f_reply == false))
+		{
+			continue;
+		}
+		//A gap or a failed command asks for a retransmission
+		type = ((port.seq.rx_mask != 0) || (port.seq.f_fail == true))?(TELEMETRY_TYPE_NAK):(TELEMETRY_TYPE_ACK);
+		payload[0] = port.seq.ack_base;
+		payload[1] = port.seq.rx_mask;
+		//if: reply made it into the TX buffer
+		if (send_frame( port, type, payload, TELEMETRY_ACK_LEN ) == false)
+		{
+			port.seq.f_reply = false;
+			port.seq.f_fail = false;
+		}
+	}	//End For: each port
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: update_seq
@@ -0,0 +1,258 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	SPEED CONTROL
+*****************************************************************
+**	Quadrature encoders and closed loop velocity control of the
+**	four wheels.
+**
+**		ENCODERS
+**	Channels A and B of the four encoders are on PORTC, see init_pin.
+**	Every edge raises the PORTC pin change ISR, which decodes the
+**	transition of each encoder with a lookup table. Four counts per
+**	encoder cycle. Invalid transitions, both channels changed, count 0.
+**	Counts go up when the motor is driven with f_dir = true.
+**	Swap CHA and CHB of an encoder that counts the wrong way.
+**
+**		VELOCITY LOOP
+**	speed_ctrl_task runs every SPEED_CTRL_PERIOD system ticks.
+**	It measures the speed of each wheel in mm/s, forward positive,
+**	from the encoder counts of the period.
+**	In closed loop mode a fixed point PI turns the speed error into
+**	the target PWM of the motor. update_pwm still applies the ramp
+**	generator to the output of the PI.
+**	Gains are Q8, 256 = 1.0 PWM step per mm/s. The integrator is
+**	clamped to the PWM range so it can't wind up.
+**	Open loop commands switch the loop off and reset the integrators
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Quadrature decoder. Index is OLD B, OLD A, NEW B, NEW A
+const int8_t enc_lut[16] =
+{
+	//	new:	00		01		10		11
+	/*old 00*/	0,		+1,		-1,		0,
+	/*old 01*/	-1,		0,		0,		+1,
+	/*old 10*/	+1,		0,		0,		-1,
+	/*old 11*/	0,		-1,		+1,		0
+};
+//Encoder counters. Written by the PORTC pin change ISR
+volatile int16_t g_enc_cnt[DC_MOTOR_NUM];
+//PORTC pins at the previous pin change
+volatile uint8_t g_enc_pins = 0;
+
+//Velocity loop of the wheels
+Speed_ctrl speed_ctrl[DC_MOTOR_NUM];
+//Closed loop mode. false = the commands set the target PWM directly
+bool f_speed_ctrl = false;
+//Proportional gain. Q8
+int16_t speed_ctrl_kp = SPEED_CTRL_KP;
+//Integral gain. Q8
+int16_t speed_ctrl_ki = SPEED_CTRL_KI;
+
+//Direction of each motor that moves the platform forward
+const bool speed_ctrl_fwd_dir[DC_MOTOR_NUM] = { true, true, false, false };
+
+/****************************************************************************
+**  Function
+**  init_speed_ctrl
+****************************************************************************/
+//! @return void |
+//! @brief Initialize encoders and velocity loops
+//! @details Loop starts open. Must be called before interrupts are enabled
+/***************************************************************************/
+
+void init_speed_ctrl( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	g_enc_pins = PORTC.IN;
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		g_enc_cnt[t] = 0;
+		speed_ctrl[t].target = 0;
+		speed_ctrl[t].speed = 0;
+		speed_ctrl[t].enc_last = 0;
+		speed_ctrl[t].integral = 0;
+	}
+	f_speed_ctrl = false;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_speed_ctrl
+
+/****************************************************************************
+**  Function
+**  speed_ctrl_task
+****************************************************************************/
+//! @return void |
+//! @brief Measure the speed of the wheels and run the velocity loops
+//! @details Called by the scheduler every SPEED_CTRL_PERIOD system ticks
+/***************************************************************************/
+
+void speed_ctrl_task( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//snapshot of the encoder counters
+	int16_t enc_cnt[DC_MOTOR_NUM];
+	//counts in the period
+	int16_t delta;
+	//speed error
+	int16_t err;
+	//output of the PI. Q8 PWM
+	int32_t out;
+	//status register
+	uint8_t sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//All the counters belong to the same instant
+	sreg_tmp = SREG;
+	cli();
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		enc_cnt[t] = g_enc_cnt[t];
+	}
+	SREG = sreg_tmp;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		Speed_ctrl &ctrl = speed_ctrl[t];
+			///Speed measure
+		//Counters wrap around, the difference doesn't
+		delta = enc_cnt[t] -ctrl.enc_last;
+		ctrl.enc_last = enc_cnt[t];
+		ctrl.speed = ((int32_t)delta *ENC_SPEED_SCALE) >> 8;
+		//Forward is positive
+		ctrl.speed = (speed_ctrl_fwd_dir[t] == true)?(ctrl.speed):(-ctrl.speed);
+
+			///Velocity loop
+		//if: loop is open or the motors are ramped down or stopped by the timeout
+		if ((f_speed_ctrl == false) || (com_timeout.tier >= COM_TIER_DECEL))
+		{
+			ctrl.integral = 0;
+			continue;
+		}
+		err = ctrl.target -ctrl.speed;
+		//Integrator clamped to the PWM range
+		ctrl.integral += (int32_t)speed_ctrl_ki *err;
+		ctrl.integral = AT_SAT( ctrl.integral, (int32_t)DC_MOTOR_MAX_DUTY, -(int32_t)DC_MOTOR_MAX_DUTY );
+		out = (int32_t)speed_ctrl_kp *err +ctrl.integral;
+		out = AT_SAT( out, (int32_t)DC_MOTOR_MAX_DUTY, -(int32_t)DC_MOTOR_MAX_DUTY );
+		//Output goes through the ramp generator with the full Q8 resolution
+		dc_motor_target.pwm[t] = (out < 0)?(-out):(out);
+		dc_motor_target.f_dir[t] = (out < 0)?(!speed_ctrl_fwd_dir[t]):(speed_ctrl_fwd_dir[t]);
+	}	//End For: scan motors
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: speed_ctrl_task
+
+/***************************************************************************/
+//!	@brief set the target speed of the wheels
+//!	platform_velocity_handler | int16_t, int16_t
+/***************************************************************************/
+//! @param right | speed of the right side of the platform in mm/s. Forward positive
+//! @param left | speed of the left side of the platform in mm/s. Forward positive
+//! @return void
+//!	@details
+//! Handler for the platform velocity command. Closes the velocity loops
+/***************************************************************************/
+
+void platform_velocity_handler( int16_t right, int16_t left )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	set_platform_speed( right, left );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: platform_velocity_handler | int16_t, int16_t
+
+/***************************************************************************/
+//!	@brief set the gains of the velocity loops
+//!	speed_gain_handler | int16_t, int16_t
+/***************************************************************************/
+//! @param kp | proportional gain. Q8
+//! @param ki | integral gain. Q8
+//! @return void
+//!	@details
+//! Handler for the velocity loop gain command. Negative gains are ignored
+/***************************************************************************/
+
+void speed_gain_handler( int16_t kp, int16_t ki )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: gains would make the loop unstable
+	if ((kp < 0) || (ki < 0))
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	speed_ctrl_kp = kp;
+	speed_ctrl_ki = ki;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: speed_gain_handler | int16_t, int16_t
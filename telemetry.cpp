@@ -0,0 +1,502 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	TELEMETRY
+*****************************************************************
+**	Binary telemetry stream toward the RPI
+**	Frames share the TX buffer of the port with the text replies.
+**	A frame starts with a byte that is never sent by the text replies
+**
+**		FRAME
+**	| SYNC | TYPE | LEN | PAYLOAD[LEN] | CHECKSUM |
+**	SYNC		: TELEMETRY_SYNC 0xA5
+**	TYPE		: frame type. ASCII letter
+**	LEN			: number of payload bytes
+**	CHECKSUM	: 8bit sum of TYPE, LEN and PAYLOAD
+**
+**		MOTOR STATE FRAME 'T'
+**	Multi byte fields are little endian
+**	| SEQ | TICK L | TICK H | PWM0..3 | TARGET PWM0..3 | DIR | TIMEOUT CNT | FLAGS |
+**	DIR			: bit 0..3 actual direction of motor 0..3 | bit 4..7 target direction of motor 0..3
+**	FLAGS		: bit 0 communication timeout detected | bit 1 a frame was delayed for lack of TX bandwidth
+**				  bit 2 link late, setpoint held | bit 3 link failing, motors ramping down
+**
+**		REPLIES
+**	The answers to the queries are frames too. A reply that doesn't fit
+**	the TX buffer is left pending and retried every tick, before the
+**	motor state frame. The payload is built when the frame is sent.
+**	Each argument of a query is answered, lowest first, so a burst
+**	of TRC0 .. TRC15 gets all the chunks. The same query with the
+**	same argument repeated before its reply went out is answered
+**	once. The board signature is a reply too, sent as plain text
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************
+**	STRUCTURES
+****************************************************************/
+
+//Reply to a query
+typedef struct _Reply_desc
+{
+	uint8_t type;									//Frame type
+	uint8_t len;									//Maximum payload length
+	uint8_t (*build)( uint8_t arg, uint8_t *payload );	//Build the payload. Returns its length
+} Reply_desc;
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Replies to the queries. Indexed by REPLY_xxx
+static const Reply_desc reply_table[ REPLY_NUM ] =
+{
+	{ TELEMETRY_TYPE_TASK,		TELEMETRY_TASK_LEN,		&task_stats_reply },
+	{ TELEMETRY_TYPE_TICK,		TELEMETRY_TICK_LEN,		&tick_stats_reply },
+	#ifdef ENABLE_PROFILE
+	{ TELEMETRY_TYPE_PROFILE,	TELEMETRY_PROFILE_LEN,	&profile_reply },
+	#else
+	{ TELEMETRY_TYPE_PROFILE,	TELEMETRY_PROFILE_LEN,	nullptr },
+	#endif
+	{ TELEMETRY_TYPE_CURRENT,	TELEMETRY_CURRENT_LEN,	&current_reply },
+	{ TELEMETRY_TYPE_DIAG,		TELEMETRY_DIAG_LEN,		&diag_reply },
+	{ TELEMETRY_TYPE_RESET,		TELEMETRY_RESET_LEN,	&reset_cause_reply },
+	{ TELEMETRY_TYPE_NONE,		BOARD_SIGN_LEN,			&signature_reply },
+	#ifdef ENABLE_TRACE
+	{ TELEMETRY_TYPE_TRACE,		TELEMETRY_TRACE_LEN,	&trace_reply },
+	#else
+	{ TELEMETRY_TYPE_TRACE,		TELEMETRY_TRACE_LEN,	nullptr },
+	#endif
+};
+
+//Subscription period in system ticks. 0 = stream disabled
+uint8_t telemetry_period = 0;
+//Ticks elapsed since the last frame was emitted
+uint8_t telemetry_pre = 0;
+//Sequence number of the next motor state frame
+uint8_t telemetry_seq = 0;
+//A frame had to be delayed because the TX buffer was too full
+bool f_telemetry_throttled = false;
+
+/****************************************************************************
+**  Function
+**  init_telemetry
+****************************************************************************/
+//! @return void |
+//! @brief Initialize the telemetry stream
+//! @details Stream starts unsubscribed. The RPI has to ask for it
+/***************************************************************************/
+
+void init_telemetry( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	telemetry_period = 0;
+	telemetry_pre = 0;
+	telemetry_seq = 0;
+	f_telemetry_throttled = false;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_telemetry
+
+/****************************************************************************
+**  Function
+**  send_frame | Uart_port &, uint8_t, const uint8_t *, uint8_t
+****************************************************************************/
+//! @param port		| port the frame is sent to
+//! @param type		| frame type
+//! @param payload	| payload bytes
+//! @param len		| number of payload bytes
+//! @return bool | false = OK | true = not enough room in the TX buffer. Nothing was pushed
+//! @brief Push a binary frame into the TX buffer of a port
+//! @details The frame is pushed whole or not at all, so the stream never carries a truncated frame
+/***************************************************************************/
+
+bool send_frame( Uart_port &port, uint8_t type, const uint8_t *payload, uint8_t len )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//running checksum
+	uint8_t checksum;
+	//free slots inside the TX buffer. A circular buffer holds one less element than its size
+	uint8_t tx_free = AT_BUF_SIZE( port.tx_buf ) -1 -AT_BUF_NUMELEM( port.tx_buf );
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//if: the whole frame doesn't fit
+	if (tx_free < (uint8_t)(len +TELEMETRY_FRAME_OVERHEAD))
+	{
+		return true;	//fail
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	AT_BUF_PUSH( port.tx_buf, TELEMETRY_SYNC );
+	AT_BUF_PUSH( port.tx_buf, type );
+	AT_BUF_PUSH( port.tx_buf, len );
+	checksum = type +len;
+	//For: each payload byte
+	for (t = 0;t < len;t++)
+	{
+		AT_BUF_PUSH( port.tx_buf, payload[t] );
+		checksum += payload[t];
+	}
+	AT_BUF_PUSH( port.tx_buf, checksum );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return false;	//OK
+}	//End: send_frame
+
+/****************************************************************************
+**  Function
+**  init_reply | Reply_status &
+****************************************************************************/
+//! @param reply | replies of a port
+//! @return void |
+//! @brief Clear the pending replies of a port
+/***************************************************************************/
+
+void init_reply( Reply_status &reply )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	reply.pending = 0;
+	//For: each query
+	for (t = 0;t < REPLY_NUM;t++)
+	{
+		reply.arg_mask[t] = 0;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_reply
+
+/****************************************************************************
+**  Function
+**  flush_reply | Uart_port &
+****************************************************************************/
+//! @param port | port whose pending replies are sent
+//! @return void |
+//! @brief Send the pending replies of a port, in REPLY_xxx order
+//! @details Stops at the first reply that doesn't fit, so that a long frame isn't
+//!	starved by the short ones behind it. The payload is built only once the frame
+//!	is known to fit, so a builder can act on the reply being sent
+/***************************************************************************/
+
+static void flush_reply( Uart_port &port )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//argument of the query
+	uint8_t arg;
+	//frame payload. A frame can't be longer than the TX buffer
+	uint8_t payload[ RPI_TX_BUF_SIZE ];
+	//payload length
+	uint8_t len;
+	//free slots inside the TX buffer. A circular buffer holds one less element than its size
+	uint8_t tx_free;
+	//bytes added by the frame
+	uint8_t overhead;
+	//counter
+	uint8_t i;
+	//the TX buffer had room for every reply sent so far
+	bool f_room = true;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each query
+	for (t = 0;(t < REPLY_NUM) && (port.reply.pending != 0) && (f_room == true);t++)
+	{
+		//if: no reply is due
+		if (IS_BIT_ZERO( port.reply.pending, t ) == true)
+		{
+			continue;
+		}
+		overhead = (reply_table[t].type == TELEMETRY_TYPE_NONE)?(0):(TELEMETRY_FRAME_OVERHEAD);
+		//For: each argument whose reply is due. Lowest first
+		for (arg = 0;(arg < REPLY_ARG_NUM) && (port.reply.arg_mask[t] != 0);arg++)
+		{
+			//if: no reply is due
+			if (IS_BIT_ZERO( port.reply.arg_mask[t], arg ) == true)
+			{
+				continue;
+			}
+			tx_free = AT_BUF_SIZE( port.tx_buf ) -1 -AT_BUF_NUMELEM( port.tx_buf );
+			//if: the frame doesn't fit yet. Retry next tick
+			if (tx_free < (uint8_t)(reply_table[t].len +overhead))
+			{
+				f_room = false;
+				break;
+			}
+			len = reply_table[t].build( arg, payload );
+			//if: plain text
+			if (reply_table[t].type == TELEMETRY_TYPE_NONE)
+			{
+				//For: each byte of the text
+				for (i = 0;i < len;i++)
+				{
+					AT_BUF_PUSH( port.tx_buf, payload[i] );
+				}
+			}
+			else
+			{
+				send_frame( port, reply_table[t].type, payload, len );
+			}
+			CLEAR_BIT( port.reply.arg_mask[t], arg );
+		}	//End For: each argument whose reply is due
+		//if: all the arguments have been answered
+		if (port.reply.arg_mask[t] == 0)
+		{
+			CLEAR_BIT( port.reply.pending, t );
+		}
+	}	//End For: each query
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: flush_reply
+
+/****************************************************************************
+**  Function
+**  send_reply | Uart_port &, uint8_t, uint8_t
+****************************************************************************/
+//! @param port		| port the query came from
+//! @param query	| REPLY_xxx
+//! @param arg		| argument of the query, passed to the payload builder. Less than REPLY_ARG_NUM
+//! @return void |
+//! @brief Answer a query on a port
+//! @details The reply goes out now if the TX buffer has room for it and for the
+//!	replies already pending on the port. Else it's left pending for update_reply
+/***************************************************************************/
+
+void send_reply( Uart_port &port, uint8_t query, uint8_t arg )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	SET_BIT( port.reply.arg_mask[query], arg );
+	SET_BIT( port.reply.pending, query );
+	flush_reply( port );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: send_reply
+
+/****************************************************************************
+**  Function
+**  update_reply
+****************************************************************************/
+//! @return void |
+//! @brief Send the pending replies of each port
+//! @details Called every system tick. A reply that doesn't fit the TX buffer is retried on the next tick
+/***************************************************************************/
+
+void update_reply( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each port
+	for (t = 0;t < UART_PORT_NUM;t++)
+	{
+		//if: port is in use
+		if (g_uart_port[t].usart != nullptr)
+		{
+			flush_reply( g_uart_port[t] );
+		}
+	}	//End For: each port
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: update_reply
+
+/****************************************************************************
+**  Function
+**  update_telemetry
+****************************************************************************/
+//! @return void |
+//! @brief Emit a motor state frame when the subscription period expires
+//! @details Called every system tick.
+//!	If the TX buffer can't take the whole frame, the frame is retried on the next tick
+//!	and the throttled flag is reported in the next frame that gets through.
+//!	The stream therefore slows down by itself to whatever the UART can sustain
+/***************************************************************************/
+
+void update_telemetry( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//frame payload
+	uint8_t payload[ TELEMETRY_MOTOR_LEN ];
+	//payload index
+	uint8_t index;
+	//packed directions
+	uint8_t dir;
+	//flags byte
+	uint8_t flags;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//if: stream is disabled
+	if (telemetry_period == 0)
+	{
+		return;
+	}
+	//if: period has not expired yet
+	if (telemetry_pre < telemetry_period)
+	{
+		telemetry_pre++;
+	}
+	//Inclusive of the delayed frames, whose prescaler is left saturated
+	if (telemetry_pre < telemetry_period)
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	index = 0;
+	payload[index++] = telemetry_seq;
+	payload[index++] = U16L( g_tick_cnt );
+	payload[index++] = U16H( g_tick_cnt );
+	dir = 0;
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		payload[index++] = U16H( dc_motor.pwm[t] );
+		SET_BIT_VALUE( dir, t, (dc_motor.f_dir[t] != false) );
+	}
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		payload[index++] = U16H( dc_motor_target.pwm[t] );
+		SET_BIT_VALUE( dir, t +4, (dc_motor_target.f_dir[t] != false) );
+	}
+	payload[index++] = dir;
+	payload[index++] = uart_timeout_cnt;
+	flags = 0;
+	SET_BIT_VALUE( flags, TELEMETRY_FLAG_TIMEOUT, f_timeout_detected );
+	SET_BIT_VALUE( flags, TELEMETRY_FLAG_THROTTLED, f_telemetry_throttled );
+	SET_BIT_VALUE( flags, TELEMETRY_FLAG_HOLD, (com_timeout.tier == COM_TIER_HOLD) );
+	SET_BIT_VALUE( flags, TELEMETRY_FLAG_DECEL, (com_timeout.tier == COM_TIER_DECEL) );
+	payload[index++] = flags;
+
+	//if: the TX buffer doesn't have room for the frame
+	if (send_frame( g_uart_port[UART_PORT_RPI], TELEMETRY_TYPE_MOTOR, payload, index ) == true)
+	{
+		//Retry next tick. The throttled flag will tell the RPI a frame was late
+		f_telemetry_throttled = true;
+	}
+	else
+	{
+		telemetry_seq++;
+		telemetry_pre = 0;
+		f_telemetry_throttled = false;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: update_telemetry
+
+/***************************************************************************/
+//!	@brief telemetry subscription handler
+//!	telemetry_handler | uint8_t
+/***************************************************************************/
+//! @param period | period of the motor state frames in system ticks. 0 stops the stream
+//! @return void
+//!	@details
+//! Handler for the telemetry subscription command. A full frame takes about 0.7ms at 256Kb/s
+//! so a period of 1 tick is accepted, and the stream throttles itself if the line is busy
+/***************************************************************************/
+
+void telemetry_handler( uint8_t period )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	telemetry_period = period;
+	//First frame goes out on the next tick
+	telemetry_pre = period;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: telemetry_handler | uint8_t
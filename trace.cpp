@@ -0,0 +1,233 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	TRACE
+*****************************************************************
+**	Binary event trace. Compiled out unless ENABLE_TRACE is defined
+**	in trace.h
+**	Unlike the debug.h macros, a record is a few stores in a RAM
+**	ring, so the trace can stay on in the firmware and in host
+**	benchmarks. trace_decode turns a dump into the indented call
+**	trace of the debug.h macros.
+**
+**		TRACE FRAME 'X' (see telemetry.cpp for the frame format)
+**	| HEAD | INDEX | CODE | ARG | TIME L | TIME H | x TRACE_FRAME_REC
+**	HEAD		: g_trace_head when the chunk was sent
+**	INDEX		: chunk. Chunk 0 holds the oldest records
+**	CODE		: TRACE_KIND_xxx | event. TRACE_KIND_NONE is a record never written
+**	TIME		: trace counts, 200ns
+**	Requesting chunk 0 freezes the ring. Sending the last chunk, the
+**	release command TRCX, or TRACE_FREEZE_TICKS without a chunk
+**	request resume the recording
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+#ifdef ENABLE_TRACE
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Ring of the trace records
+Trace_record g_trace[ TRACE_SIZE ];
+//Number of records written
+uint8_t g_trace_head = 0;
+//Records are dropped while the ring is being dumped
+bool g_trace_f_freeze = false;
+//System tick of the last chunk request. Times out the freeze
+uint16_t g_trace_freeze_tick = 0;
+
+/****************************************************************************
+**  Function
+**  trace_thaw | void
+****************************************************************************/
+//! @return bool | true = the ring is not frozen anymore
+//! @brief Release the ring of a dump that timed out
+//! @details Called by trace_record while the ring is frozen. A host that stops
+//!	halfway through a dump would otherwise leave the trace off for good
+/***************************************************************************/
+
+bool trace_thaw( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: no chunk was requested for too long
+	if ((uint16_t)(g_tick_cnt -g_trace_freeze_tick) >= TRACE_FREEZE_TICKS)
+	{
+		g_trace_f_freeze = false;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return (g_trace_f_freeze == false);
+}	//End: trace_thaw
+
+/****************************************************************************
+**  Function
+**  trace_chunk | uint8_t, uint8_t *
+****************************************************************************/
+//! @param index	| chunk of the ring. Chunk 0 holds the oldest records
+//! @param payload	| output. Payload of the trace frame. TELEMETRY_TRACE_LEN bytes
+//! @return uint8_t | number of bytes of the payload
+//! @brief Copy a chunk of the ring into the payload of a trace frame
+/***************************************************************************/
+
+uint8_t trace_chunk( uint8_t index, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//payload index
+	uint8_t i;
+	//position of the record in the ring. The oldest record is at head
+	uint8_t pos;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	i = 0;
+	payload[i++] = g_trace_head;
+	payload[i++] = index;
+	pos = g_trace_head +index *TRACE_FRAME_REC;
+	//For: records in the chunk
+	for (t = 0;t < TRACE_FRAME_REC;t++)
+	{
+		Trace_record &rec = g_trace[ (uint8_t)(pos +t) & (TRACE_SIZE -1) ];
+		payload[i++] = rec.code;
+		payload[i++] = rec.arg;
+		payload[i++] = U16L( rec.time );
+		payload[i++] = U16H( rec.time );
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return i;
+}	//End: trace_chunk
+
+/****************************************************************************
+**  Function
+**  trace_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param index	| chunk of the ring. Checked by the handler
+//! @param payload	| output. TELEMETRY_TRACE_LEN bytes
+//! @return uint8_t | payload length
+//! @brief Build the payload of the trace frame
+//! @details Called only once the frame fits the TX buffer, so the ring
+//!	is released as the last chunk is sent
+/***************************************************************************/
+
+uint8_t trace_reply( uint8_t index, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//payload index
+	uint8_t i;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	i = trace_chunk( index, payload );
+	//if: that was the last chunk
+	if (index == TRACE_SIZE /TRACE_FRAME_REC -1)
+	{
+		g_trace_f_freeze = false;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return i;
+}	//End: trace_reply
+
+/***************************************************************************/
+//!	@brief trace dump handler
+//!	trace_handler | uint8_t
+/***************************************************************************/
+//! @param index | chunk of the ring to be dumped
+//! @return void
+//!	@details
+//! Handler for the trace dump command. Answers with a trace frame, see trace_reply. Out of range chunks are ignored.
+//!	Chunk 0 freezes the ring until the last chunk is sent, so that the dump isn't overwritten
+//!	by the trace of the dump commands themselves. Each request restarts the freeze timeout
+/***************************************************************************/
+
+void trace_handler( uint8_t index )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: there is no such chunk
+	if (index >= TRACE_SIZE /TRACE_FRAME_REC)
+	{
+		return;
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: start of a dump
+	if (index == 0)
+	{
+		g_trace_f_freeze = true;
+	}
+	g_trace_freeze_tick = g_tick_cnt;
+	//Answer on the port that asked, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_TRACE, index );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: trace_handler | uint8_t
+
+/***************************************************************************/
+//!	@brief trace release handler
+//!	trace_release_handler | void
+/***************************************************************************/
+//! @return void
+//!	@details
+//! Handler for the trace release command. Resumes the recording without dumping the rest of the ring
+/***************************************************************************/
+
+void trace_release_handler( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	g_trace_f_freeze = false;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: trace_release_handler | void
+
+#endif
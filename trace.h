@@ -0,0 +1,175 @@
+#ifndef TRACE_H
+	#define TRACE_H
+
+	/**********************************************************************************
+	**	ENVIROMENT VARIABILE
+	**********************************************************************************/
+
+	//A trace record costs a few instructions. Cheap enough to be left on
+	#define ENABLE_TRACE
+
+	/**********************************************************************************
+	**	GLOBAL INCLUDE
+	**********************************************************************************/
+
+	//type definition using the bit width and signedness
+	#include <stdint.h>
+
+	#ifdef ENABLE_TRACE
+		#ifdef __AVR__
+			//TCA0 counter is the timebase
+			#include <avr/io.h>
+		#else
+			//Host builds use the monotonic clock of the OS
+			#include <chrono>
+		#endif
+	#endif
+
+	/**********************************************************************************
+	**	DEFINE
+	**********************************************************************************/
+	//	Traced events. Add an index before TRACE_NUM and its name to TRACE_NAMES to trace a new event
+
+	//Parser. One RX byte. Enter: byte | Exit: TRACE_OK or TRACE_FAIL
+	#define TRACE_PARSER_EXE		0
+	//Parser. Handler of a command. Enter: command index | Exit: TRACE_OK or TRACE_FAIL
+	#define TRACE_PARSER_HANDLER	1
+	//Communication timeout moved to another tier. Point: COM_TIER_xxx
+	#define TRACE_COM_TIER			2
+	//Number of traced events
+	#define TRACE_NUM				3
+	//Names of the events, used by the host decoder. Must follow the indexes
+	#define TRACE_NAMES				{ "exe", "exe_handler", "com_tier" }
+
+	//Kind of record. Upper two bits of the code. A record that was never written is TRACE_KIND_NONE
+	#define TRACE_KIND_NONE			0x00
+	#define TRACE_KIND_ENTER		0x40
+	#define TRACE_KIND_EXIT			0x80
+	#define TRACE_KIND_POINT		0xC0
+	#define TRACE_KIND_MASK			0xC0
+
+	//Argument of the exit records
+	#define TRACE_OK				0
+	#define TRACE_FAIL				1
+
+	//Number of records in the ring. Must be a power of two, no bigger than 256
+	#define TRACE_SIZE				64
+	//Records in a trace frame. Must divide TRACE_SIZE
+	#define TRACE_FRAME_REC			4
+	//Length of a record in a trace frame. CODE, ARG, TIME(2)
+	#define TRACE_REC_LEN			4
+
+	//Length of a trace count in ns. Same timebase as the section profiler
+	#define TRACE_NS_PER_CNT		200
+
+	//A dump left unfinished releases the ring after this many system ticks without a chunk request. 0.5s
+	#define TRACE_FREEZE_TICKS		256
+
+	/**********************************************************************************
+	**	MACRO
+	**********************************************************************************/
+	//	Records go in a RAM ring, the oldest is overwritten. Record from the main loop only:
+	//	the ring index is not atomic and a 16bit read of TCA0 in an ISR corrupts the one in the main loop.
+	//	Records are not written while the ring is being dumped, or until the dump times out
+
+	#ifdef ENABLE_TRACE
+
+		//Record entering a traced function
+		#define TRACE_ENTER( id, arg )	\
+			trace_record( TRACE_KIND_ENTER | (id), (arg) )
+
+		//Record leaving a traced function. Every return must leave
+		#define TRACE_EXIT( id, arg )	\
+			trace_record( TRACE_KIND_EXIT | (id), (arg) )
+
+		//Record an event
+		#define TRACE_POINT( id, arg )	\
+			trace_record( TRACE_KIND_POINT | (id), (arg) )
+
+	#else
+
+		#define TRACE_ENTER( ... )
+
+		#define TRACE_EXIT( ... )
+
+		#define TRACE_POINT( ... )
+
+	#endif
+
+	/**********************************************************************************
+	**	TYPEDEF
+	**********************************************************************************/
+
+	#ifdef ENABLE_TRACE
+
+	//A trace record
+	typedef struct _Trace_record Trace_record;
+
+	/**********************************************************************************
+	**	PROTOTYPE: STRUCTURE
+	**********************************************************************************/
+
+	//A trace record. 4 bytes
+	struct _Trace_record
+	{
+		uint8_t code;			//TRACE_KIND_xxx | event
+		uint8_t arg;			//Payload of the event
+		uint16_t time;			//Timestamp. Trace counts, wraps every 13.1ms
+	};
+
+	/**********************************************************************************
+	**	PROTOTYPE: GLOBAL VARIABILE
+	**********************************************************************************/
+
+	//Ring of the trace records
+	extern Trace_record g_trace[ TRACE_SIZE ];
+	//Number of records written. Free running, the next record goes in g_trace[ g_trace_head %TRACE_SIZE ]
+	extern uint8_t g_trace_head;
+	//Records are dropped while the ring is being dumped
+	extern bool g_trace_f_freeze;
+	//System tick of the last chunk request. Times out the freeze
+	extern uint16_t g_trace_freeze_tick;
+
+	/**********************************************************************************
+	**	PROTOTYPE: FUNCTION
+	**********************************************************************************/
+
+	//Copy a chunk of the ring, oldest records first, into the payload of a trace frame
+	extern uint8_t trace_chunk( uint8_t index, uint8_t *payload );
+	//Build the payload of the trace frame. Releases the ring after the last chunk. Returns the payload length
+	extern uint8_t trace_reply( uint8_t index, uint8_t *payload );
+	//Release the ring if the dump timed out. Returns true if the ring can be written
+	extern bool trace_thaw( void );
+	//Handler for the trace dump command
+	extern void trace_handler( uint8_t index );
+	//Handler for the trace release command
+	extern void trace_release_handler( void );
+
+	//Read the trace timebase
+	inline uint16_t trace_timestamp( void )
+	{
+		#ifdef __AVR__
+			return TCA0.SINGLE.CNT;
+		#else
+			return (uint16_t)(std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() /TRACE_NS_PER_CNT);
+		#endif
+	}
+
+	//Write a record in the ring
+	inline void trace_record( uint8_t code, uint8_t arg )
+	{
+		if ((g_trace_f_freeze == false) || (trace_thaw() == true))
+		{
+			Trace_record &rec = g_trace[ g_trace_head & (TRACE_SIZE -1) ];
+			rec.code = code;
+			rec.arg = arg;
+			rec.time = trace_timestamp();
+			g_trace_head++;
+		}
+	}
+
+	#endif
+
+#else
+	#warning "multiple inclusion of the header file"
+#endif
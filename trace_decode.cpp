@@ -0,0 +1,277 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	TRACE DECODER
+*****************************************************************
+**	Host tool. Not part of the firmware.
+**	Decodes a dump of the trace ring into the indented call trace
+**	printed by the debug.h macros, with the time of each record.
+**	Input is the raw byte stream received from the board after the
+**	commands TRC0 .. TRC15, text replies and other frames included.
+**	Trace frames are picked by SYNC, TYPE and CHECKSUM.
+**
+**		USAGE
+**	trace_decode [capture file]
+**	Reads stdin when no file is given. Writes the trace on stdout
+**
+**		TIME
+**	Timestamps are 16bit trace counts, so a gap longer than 13.1ms
+**	between two records can't be told apart from a shorter one
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+//Record format and names of the events
+#include "trace.h"
+
+/****************************************************************
+**	DEFINES
+****************************************************************/
+
+//Frame fields. Must match global.h
+#define TELEMETRY_SYNC			0xA5
+#define TELEMETRY_TYPE_TRACE	'X'
+#define TELEMETRY_TRACE_LEN		(2 +TRACE_FRAME_REC *TRACE_REC_LEN)
+//Number of chunks of the ring
+#define TRACE_CHUNK_NUM			(TRACE_SIZE /TRACE_FRAME_REC)
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Names of the events
+const char *trace_name[ TRACE_NUM ] = TRACE_NAMES;
+//Ring rebuilt from the chunks, oldest record first
+Trace_record trace_ring[ TRACE_SIZE ];
+//Chunks received
+bool trace_f_chunk[ TRACE_CHUNK_NUM ];
+
+/****************************************************************************
+**  Function
+**  decode_frame | const uint8_t *
+****************************************************************************/
+//! @param payload	| payload of a trace frame
+//! @return void |
+//! @brief Copy the records of a trace frame in the rebuilt ring
+/***************************************************************************/
+
+void decode_frame( const uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//chunk
+	uint8_t index = payload[1];
+	//payload index
+	uint8_t i;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	if (index >= TRACE_CHUNK_NUM)
+	{
+		return;
+	}
+	i = 2;
+	//For: records in the chunk
+	for (t = 0;t < TRACE_FRAME_REC;t++)
+	{
+		Trace_record &rec = trace_ring[ index *TRACE_FRAME_REC +t ];
+		rec.code = payload[i++];
+		rec.arg = payload[i++];
+		rec.time = payload[i++];
+		rec.time |= (uint16_t)payload[i++] << 8;
+	}
+	trace_f_chunk[index] = true;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: decode_frame
+
+/****************************************************************************
+**  Function
+**  print_trace
+****************************************************************************/
+//! @return void |
+//! @brief Print the rebuilt ring as an indented call trace
+//! @details Records that were never written are skipped. Exits without an enter,
+//!	whose enter was overwritten by the ring, don't move the indentation below zero
+/***************************************************************************/
+
+void print_trace( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint16_t t;
+	//indentation level
+	int indent = 0;
+	//time of the record from the first record. trace counts
+	uint32_t time = 0;
+	//time of the previous record
+	uint16_t time_old = 0;
+	//the first record has been printed
+	bool f_first = true;
+	//event and kind of the record
+	uint8_t id, kind;
+	//name of the event
+	const char *name;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	printf("Start Trace!\n");
+	//For: records, oldest first
+	for (t = 0;t < TRACE_SIZE;t++)
+	{
+		if (trace_f_chunk[ t /TRACE_FRAME_REC ] == false)
+		{
+			if ((t %TRACE_FRAME_REC) == 0)
+			{
+				printf("Chunk %d is missing\n", t /TRACE_FRAME_REC);
+			}
+			continue;
+		}
+		Trace_record &rec = trace_ring[t];
+		kind = rec.code & TRACE_KIND_MASK;
+		id = rec.code & ~TRACE_KIND_MASK;
+		if (kind == TRACE_KIND_NONE)
+		{
+			continue;
+		}
+		name = (id < TRACE_NUM)?(trace_name[id]):("?");
+		//Accumulate the deltas. The counter wraps
+		if (f_first == false)
+		{
+			time += (uint16_t)(rec.time -time_old);
+		}
+		f_first = false;
+		time_old = rec.time;
+		if ((kind == TRACE_KIND_EXIT) && (indent > 0))
+		{
+			indent--;
+		}
+		printf("%10.1fus %.*s", time *TRACE_NS_PER_CNT /1000.0, indent, "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t");
+		if (kind == TRACE_KIND_ENTER)
+		{
+			printf("-->> \"%s\" | 0x%x\n", name, rec.arg);
+			indent = (indent < 32)?(indent +1):(indent);
+		}
+		else if (kind == TRACE_KIND_EXIT)
+		{
+			printf("<<-- \"%s\" | 0x%x\n", name, rec.arg);
+		}
+		else
+		{
+			printf("\"%s\" | 0x%x\n", name, rec.arg);
+		}
+	}
+	printf("\nTrace has Ended!\n");
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: print_trace
+
+/****************************************************************************
+**  Function
+**  main | int, char **
+****************************************************************************/
+//! @return int | 0: OK | 1: the capture can't be read
+//! @brief Scan the capture for trace frames and print the trace
+/***************************************************************************/
+
+int main( int argc, char **argv )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	FILE *file = stdin;
+	//frame being received. TYPE, LEN, PAYLOAD, CHECKSUM
+	uint8_t frame[ TELEMETRY_TRACE_LEN +3 ];
+	//bytes of the frame received after SYNC. 0 = waiting for SYNC
+	uint8_t num = 0;
+	//running checksum
+	uint8_t checksum = 0;
+	//input byte
+	int data;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	if (argc > 1)
+	{
+		file = fopen( argv[1], "rb" );
+		if (file == NULL)
+		{
+			fprintf( stderr, "can't open %s\n", argv[1] );
+			return 1;
+		}
+	}
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	while ((data = fgetc( file )) != EOF)
+	{
+		//if: waiting for the start of a frame
+		if (num == 0)
+		{
+			if (data == TELEMETRY_SYNC)
+			{
+				num = 1;
+				checksum = 0;
+			}
+			continue;
+		}
+		frame[num -1] = (uint8_t)data;
+		num++;
+		//if: not a trace frame. Look for the next SYNC
+		if (((num == 2) && (data != TELEMETRY_TYPE_TRACE)) || ((num == 3) && (data != TELEMETRY_TRACE_LEN)))
+		{
+			num = (data == TELEMETRY_SYNC)?(1):(0);
+			continue;
+		}
+		//if: frame complete
+		if (num > TELEMETRY_TRACE_LEN +3)
+		{
+			if ((uint8_t)data == checksum)
+			{
+				decode_frame( &frame[2] );
+			}
+			num = 0;
+			continue;
+		}
+		checksum += (uint8_t)data;
+	}
+	if (file != stdin)
+	{
+		fclose( file );
+	}
+	print_trace();
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return 0;
+}	//End: main
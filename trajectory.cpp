@@ -0,0 +1,198 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	TRAJECTORY
+*****************************************************************
+**	Ramp generator between the target PWM of a motor and the PWM
+**	applied to the driver. Replaces the fixed slew rate limiter.
+**
+**	The output is a signed PWM, positive = f_dir true, in Q8 so
+**	that slow ramps can move by a fraction of a PWM step per tick.
+**	Each motor has its own limits, Q8 PWM per system tick:
+**	ACCEL	: while the magnitude of the PWM grows
+**	DECEL	: while the magnitude of the PWM shrinks
+**	JERK	: change of the ramp per tick. 0 = linear ramps
+**	A reversal decelerates to zero with the DECEL limit then
+**	accelerates with the ACCEL limit.
+**	With a jerk limit the ramp starts and ends smoothly (S-curve).
+**	The ramp is reduced early enough to land on the target without
+**	overshoot: the braking distance at ramp r is r^2 /(2 JERK)
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Ramp generators of the motors
+Trajectory trajectory;
+
+/****************************************************************************
+**  Function
+**  init_trajectory
+****************************************************************************/
+//! @return void |
+//! @brief Initialize the ramp generators
+//! @details Linear ramps of DC_MOTOR_SLEW_RATE PWM steps per tick, as the old slew rate limiter
+/***************************************************************************/
+
+void init_trajectory( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		trajectory.value[t] = 0;
+		trajectory.rate[t] = 0;
+		trajectory.accel[t] = (uint16_t)DC_MOTOR_SLEW_RATE << 8;
+		trajectory.decel[t] = (uint16_t)DC_MOTOR_SLEW_RATE << 8;
+		trajectory.jerk[t] = 0;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_trajectory
+
+/****************************************************************************
+**  Function
+**  trajectory_step | uint8_t, int32_t
+****************************************************************************/
+//! @param index	| index of the motor
+//! @param target	| target PWM. Q8 signed
+//! @return int32_t | output PWM. Q8 signed
+//! @brief Advance the ramp generator of a motor by one system tick
+//! @details The linear ramp is a single saturation of the distance from the target
+/***************************************************************************/
+
+int32_t trajectory_step( uint8_t index, int32_t target )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//state of the ramp
+	int32_t value = trajectory.value[index];
+	int32_t jerk = trajectory.jerk[index];
+	//distance from the target
+	int32_t err = target -value;
+	//distance from the target. Magnitude
+	int32_t dist = (err < 0)?(-err):(err);
+	//ramp toward the target. Negative if moving away from it
+	int32_t ramp;
+	//limit of the ramp. ACCEL if the magnitude grows, DECEL if it shrinks
+	int32_t limit = (((value ^ err) >= 0) || (value == 0))?(trajectory.accel[index]):(trajectory.decel[index]);
+	//change of the output
+	int32_t step;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: linear ramps
+	if (jerk == 0)
+	{
+		step = AT_SAT( err, limit, -limit );
+	}
+	//if: S-curve
+	else
+	{
+		ramp = (err < 0)?(-trajectory.rate[index]):(trajectory.rate[index]);
+		//if: moving away from the target or still far from the braking point. Else brake, but never stop short of the target
+		ramp = ((ramp < 0) || (ramp *ramp < 2 *jerk *dist))?(ramp +jerk):(AT_SAT( ramp -jerk, INT32_MAX, jerk ));
+		//Land on the target. Hold it once reached
+		ramp = (ramp > limit)?(limit):(ramp);
+		step = (ramp > dist)?(dist):(ramp);
+		step = (err < 0)?(-step):((err == 0)?(0):(step));
+	}
+	//if: the step crosses zero. Stop there, the other side has a different limit
+	step = (((value ^ (value +step)) < 0) && (value != 0))?(-value):(step);
+	trajectory.value[index] = value +step;
+	trajectory.rate[index] = step;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return value +step;
+}	//End: trajectory_step
+
+/***************************************************************************/
+//!	@brief set the ramp limits of the motors
+//!	trajectory_handler | uint16_t, uint16_t, uint16_t, uint16_t
+/***************************************************************************/
+//! @param index	| index of the motor. DC_MOTOR_NUM or above sets all the motors
+//! @param accel	| limit while the PWM magnitude grows. Q8 PWM per tick
+//! @param decel	| limit while the PWM magnitude shrinks. Q8 PWM per tick
+//! @param jerk		| change of the ramp per tick. Q8 PWM per tick per tick. 0 = linear ramps
+//! @return void
+//!	@details
+//! Handler for the trajectory limits command. A zero ACCEL or DECEL would freeze the motor and is ignored.
+//!	Limits are clipped to the full PWM range in one tick, which also keeps the braking math inside 32bit
+/***************************************************************************/
+
+void trajectory_handler( uint16_t index, uint16_t accel, uint16_t decel, uint16_t jerk )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+	//if: the motor would never move
+	if ((accel == 0) || (decel == 0))
+	{
+		return;
+	}
+
+	accel = (accel > TRAJ_LIMIT_MAX)?(TRAJ_LIMIT_MAX):(accel);
+	decel = (decel > TRAJ_LIMIT_MAX)?(TRAJ_LIMIT_MAX):(decel);
+	jerk = (jerk > TRAJ_LIMIT_MAX)?(TRAJ_LIMIT_MAX):(jerk);
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: scan motors
+	for (t = 0;t < DC_MOTOR_NUM;t++)
+	{
+		//if: not the selected motor
+		if ((index < DC_MOTOR_NUM) && (index != t))
+		{
+			continue;
+		}
+		trajectory.accel[t] = accel;
+		trajectory.decel[t] = decel;
+		trajectory.jerk[t] = jerk;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: trajectory_handler | uint16_t, uint16_t, uint16_t, uint16_t
@@ -0,0 +1,239 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	USART PORTS
+*****************************************************************
+**	A port bundles an USART peripheral, its RX and TX circular
+**	buffers and the command parser fed by the RX data.
+**	The RX ISR of each USART calls uart_port_rx_isr on its port.
+**	The main loop calls uart_port_service, which serves every
+**	port in turn so that no port can starve the others.
+**	When the main loop goes to sleep with TX data pending, the DRE
+**	interrupt of the USART is armed to wake it up. The DRE ISR of
+**	each USART calls uart_port_dre_isr on its port.
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//USART ports with their buffers and parsers
+Uart_port g_uart_port[ UART_PORT_NUM ];
+//Port whose parser is running
+Uart_port *g_uart_port_active = &g_uart_port[ UART_PORT_RPI ];
+
+/****************************************************************************
+**  Function
+**  init_uart_port | Uart_port &, USART_t &, uint8_t *, uint8_t, uint8_t *, uint8_t
+****************************************************************************/
+//! @param port		| port to be initialized
+//! @param usart	| USART peripheral served by the port
+//! @param rx_vect	| working vector of the RX buffer
+//! @param rx_size	| size of the RX working vector
+//! @param tx_vect	| working vector of the TX buffer
+//! @param tx_size	| size of the TX working vector
+//! @return void |
+//! @brief Bind an USART peripheral and its buffer vectors to a port
+//! @details Must be called before interrupts are enabled.
+//!	The USART peripheral itself is configured by init_uart
+/***************************************************************************/
+
+void init_uart_port( Uart_port &port, USART_t &usart, uint8_t *rx_vect, uint8_t rx_size, uint8_t *tx_vect, uint8_t tx_size )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Link the peripheral
+	port.usart = &usart;
+	//attach vector to buffer
+	AT_BUF_ATTACH( port.rx_buf, rx_vect, rx_size );
+	AT_BUF_FLUSH_SAFE( port.rx_buf );
+	//attach vector to buffer
+	AT_BUF_ATTACH( port.tx_buf, tx_vect, tx_size );
+	AT_BUF_FLUSH( port.tx_buf );
+	//No sequence numbered command received yet
+	init_seq( port.seq );
+	//No query to answer yet
+	init_reply( port.reply );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_uart_port
+
+/****************************************************************************
+**  Function
+**  uart_port_service
+****************************************************************************/
+//! @return void |
+//! @brief Serve all the USART ports
+//! @details Round robin. Each call moves at most one TX byte and one RX byte per port.
+//!	Checks in the RX heartbeat, and the TX one if every TX buffer is empty or moved a byte
+/***************************************************************************/
+
+void uart_port_service( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+	//every TX buffer is empty or moved a byte
+	bool f_tx_beat = true;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each port
+	for (t = 0;t < UART_PORT_NUM;t++)
+	{
+		//Fetch port
+		Uart_port &port = g_uart_port[t];
+		//if: port is not in use
+		if (port.usart == nullptr)
+		{
+			continue;
+		}
+
+		//----------------------------------------------------------------
+		//	AT4809 --> USART TX
+		//----------------------------------------------------------------
+
+		//if: TX buffer is not empty and the TX HW buffer is ready to transmit
+		if ( (AT_BUF_NUMELEM( port.tx_buf ) > 0) && (IS_BIT_ONE(port.usart -> STATUS, USART_DREIF_bp)))
+		{
+			PROFILE_SCOPE( PROFILE_UART_TX );
+			//temp var
+			uint8_t tx_tmp;
+			//Get the byte to be sent
+			tx_tmp = AT_BUF_PEEK( port.tx_buf );
+			AT_BUF_KICK( port.tx_buf );
+			//Send data through the USART
+			port.usart -> TXDATAL = tx_tmp;
+		}	//End If: TX
+		//if: TX is waiting for the USART
+		else if (AT_BUF_NUMELEM( port.tx_buf ) > 0)
+		{
+			f_tx_beat = false;
+		}
+
+		//----------------------------------------------------------------
+		//	USART RX --> AT4809
+		//----------------------------------------------------------------
+
+		//if: RX buffer is not empty
+		if (AT_BUF_NUMELEM( port.rx_buf ) > 0)
+		{
+			//temp var
+			uint8_t rx_tmp;
+
+				///Get data
+			//Get the byte from the RX buffer (ISR put it there)
+			rx_tmp = AT_BUF_PEEK( port.rx_buf );
+			AT_BUF_KICK_SAFER( port.rx_buf );
+
+				///Loopback
+			//Push into tx buffer
+			//AT_BUF_PUSH( port.tx_buf, rx_tmp );
+
+				///Command parser
+			//Handlers will answer to this port
+			g_uart_port_active = &port;
+			//Sample the executed commands counter
+			uint8_t num_exe = port.parser.get_num_exe();
+			//feed the input RX byte to the parser
+			PROFILE_START( PROFILE_PARSER_EXE );
+			port.parser.exe( rx_tmp );
+			PROFILE_STOP( PROFILE_PARSER_EXE );
+			//if: the byte closed a command
+			if (rx_tmp == '\0')
+			{
+				//Account the command against the pending sequence number if any
+				seq_command_done( port, (port.parser.get_num_exe() != num_exe) );
+			}
+		} //endif: RX buffer is not empty
+	}	//End For: each port
+
+	//Heartbeats of the RX and TX drains
+	WDT_BEAT( WDT_BEAT_RX );
+	if (f_tx_beat == true)
+	{
+		WDT_BEAT( WDT_BEAT_TX );
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: uart_port_service
+
+/****************************************************************************
+**  Function
+**  uart_port_arm_wakeup
+****************************************************************************/
+//! @return bool | false = ports are idle, the wake up is armed | true = a port has work pending
+//! @brief Check whether the ports can wait for an interrupt
+//! @details Must be called with interrupts disabled, right before going to sleep.
+//!	RX data wakes up the CPU through the RX interrupt. TX data waiting for the USART
+//!	arms the DRE interrupt, which disarms itself
+/***************************************************************************/
+
+bool uart_port_arm_wakeup( void )
+{
+	//----------------------------------------------------------------
+	//	VARS
+	//----------------------------------------------------------------
+
+	//counter
+	uint8_t t;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//For: each port
+	for (t = 0;t < UART_PORT_NUM;t++)
+	{
+		//Fetch port
+		Uart_port &port = g_uart_port[t];
+		//if: port is not in use
+		if (port.usart == nullptr)
+		{
+			continue;
+		}
+		//if: RX data is waiting for the parser
+		if (AT_BUF_NUMELEM( port.rx_buf ) > 0)
+		{
+			return true;
+		}
+		//if: TX data is waiting
+		if (AT_BUF_NUMELEM( port.tx_buf ) > 0)
+		{
+			//if: the USART can already take a byte
+			if (IS_BIT_ONE( port.usart -> STATUS, USART_DREIF_bp ))
+			{
+				return true;
+			}
+			//Wake up as soon as the USART can take the byte
+			SET_BIT( port.usart -> CTRLA, USART_DREIE_bp );
+		}
+	}	//End For: each port
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return false;	//OK
+}	//End: uart_port_arm_wakeup
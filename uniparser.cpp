@@ -60,7 +60,22 @@
 
 #include <stdint.h>
 //#define ENABLE_DEBUG
+//Compile time debug level of the modules of the parser. DEBUG_LEVEL_NONE, ERROR, INFO, TRACE. Can be set by the build
+//Per byte decoding. exe, argument decoder
+#ifndef DEBUG_PARSER_EXE
+	#define DEBUG_PARSER_EXE		DEBUG_LEVEL_TRACE
+#endif
+//Handler execution. exe_handler, argument getters
+#ifndef DEBUG_PARSER_HANDLER
+	#define DEBUG_PARSER_HANDLER	DEBUG_LEVEL_TRACE
+#endif
+//Command registration. add_cmd, syntax check
+#ifndef DEBUG_PARSER_SETUP
+	#define DEBUG_PARSER_SETUP		DEBUG_LEVEL_TRACE
+#endif
 #include "debug.h"
+//Binary event trace
+#include "trace.h"
 //Class Header
 #include "uniparser.h"
 
@@ -186,6 +201,7 @@ Uniparser::~Uniparser( void )
 
 const char *Uniparser::get_syntax_error( void )
 {
+	DMODULE( DEBUG_PARSER_SETUP );
 	DENTER();
 
 	//----------------------------------------------------------------
@@ -213,6 +229,20 @@ const char *Uniparser::get_syntax_error( void )
 	return ret_str;
 }	//end method: get_syntax_error | void
 
+/***************************************************************************/
+//!	@brief Public Getter
+//!	get_num_exe | void
+/***************************************************************************/
+//! @return uint8_t | number of handlers executed so far. Wraps around
+//!	@details
+//! Sample before and after feeding a terminator to exe. A change means the command was executed
+/***************************************************************************/
+
+uint8_t Uniparser::get_num_exe( void )
+{
+	return this -> g_num_exe;
+}	//end method: get_num_exe | void
+
 /****************************************************************************
 *****************************************************************************
 **	TESTERS
@@ -239,6 +269,7 @@ const char *Uniparser::get_syntax_error( void )
 
 bool Uniparser::add_cmd( const char *cmd, void *handler )
 {
+	DMODULE( DEBUG_PARSER_SETUP );
 	DENTER_ARG("cmd: %p >%s<\n", (void *)cmd, cmd );
 
 	//----------------------------------------------------------------
@@ -256,21 +287,21 @@ bool Uniparser::add_cmd( const char *cmd, void *handler )
 	if ((cmd == nullptr) || (handler == nullptr))
 	{
 		this -> g_err = ERR_INVALID_CMD;
-		DRETURN_ARG("ERR%d: ERR_INVALID_CMD\n", this -> g_err);
+		DRETURN_ERR("ERR%d: ERR_INVALID_CMD\n", this -> g_err);
 		return true;	//fail
 	}
 	//If: num command is invalid
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ((this -> g_num_cmd < 0) || (this->g_num_cmd >= UNIPARSER_MAX_CMD)) )
 	{
 		this -> g_err = ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//if: maximum number of command has been reached
 	if (this -> g_num_cmd >= (UNIPARSER_MAX_CMD-1))
 	{
 		this -> g_err = ERR_ADD_MAX_CMD;
-		DRETURN_ARG("ERR%d: ERR_ADD_MAX_CMD in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_ADD_MAX_CMD in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	// check the validity of the string
@@ -318,6 +349,7 @@ bool Uniparser::add_cmd( const char *cmd, void *handler )
 
 bool Uniparser::add_cmd( const char *cmd, void *handler, Cmd_syntax_error &err_code )
 {
+	DMODULE( DEBUG_PARSER_SETUP );
 	DENTER_ARG("cmd: %p >%s<\n", (void *)cmd, cmd );
 
 	//----------------------------------------------------------------
@@ -335,21 +367,21 @@ bool Uniparser::add_cmd( const char *cmd, void *handler, Cmd_syntax_error &err_c
 	if ((cmd == nullptr) || (handler == nullptr))
 	{
 		this -> g_err = ERR_INVALID_CMD;
-		DRETURN_ARG("ERR%d: ERR_INVALID_CMD\n", this -> g_err);
+		DRETURN_ERR("ERR%d: ERR_INVALID_CMD\n", this -> g_err);
 		return true;	//fail
 	}
 	//If: num command is invalid
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ((this->g_num_cmd < 0) || (this->g_num_cmd >= UNIPARSER_MAX_CMD)) )
 	{
 		this -> g_err = ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//if: maximum number of command has been reached
 	if (this -> g_num_cmd >= (UNIPARSER_MAX_CMD-1))
 	{
 		this -> g_err = ERR_ADD_MAX_CMD;
-		DRETURN_ARG("ERR%d: ERR_ADD_MAX_CMD in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_ADD_MAX_CMD in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -397,6 +429,7 @@ bool Uniparser::add_cmd( const char *cmd, void *handler, Cmd_syntax_error &err_c
 
 bool Uniparser::exe( uint8_t data )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	if ((data < '0') || (data > 'z'))
 	{
 		DENTER_ARG("exe: >0x%x<\n", data );
@@ -405,6 +438,7 @@ bool Uniparser::exe( uint8_t data )
 	{
 		DENTER_ARG("exe: >0x%x< >%c<\n", data, data );
 	}
+	TRACE_ENTER( TRACE_PARSER_EXE, data );
 
 	//----------------------------------------------------------------
 	//	VARS
@@ -472,9 +506,10 @@ bool Uniparser::exe( uint8_t data )
 						//If: index is not pointing to an argument descriptor inside the command
 						if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_cmd_txt[t][cmd_index] != '%'))
 						{
-							DPRINT("ERR: This command should have an argument descriptor in this position. | cmd: %d | cmd_index: %d | actual content: >0x%x<\n", t, cmd_index, this -> g_cmd_txt[t][cmd_index]);
+							DPRINT_ERR("ERR: This command should have an argument descriptor in this position. | cmd: %d | cmd_index: %d | actual content: >0x%x<\n", t, cmd_index, this -> g_cmd_txt[t][cmd_index]);
 							this -> g_err = Err_codes::ERR_GENERIC;
-							DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+							DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+							TRACE_EXIT( TRACE_PARSER_EXE, TRACE_FAIL );
 							return true;	//fail
 						}
 						//The argument has been closed. I need to skip the argument descriptor "%?"
@@ -493,7 +528,8 @@ bool Uniparser::exe( uint8_t data )
 						{
 							//this should never happen
 							this -> g_err = Err_codes::ERR_GENERIC;
-							DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+							DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+							TRACE_EXIT( TRACE_PARSER_EXE, TRACE_FAIL );
 							return true;	//fail
 						}
 						//Issue execution of the callback function linked
@@ -523,9 +559,10 @@ bool Uniparser::exe( uint8_t data )
 				//If: index is not pointing to an argument descriptor inside the command
 				if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_cmd_txt[t][cmd_index] != '%'))
 				{
-					DPRINT("ERR: This command should have an argument descriptor in this position. | cmd: %d | cmd_index: %d | actual content: >0x%x<\n", t, cmd_index, this -> g_cmd_txt[t][cmd_index]);
+					DPRINT_ERR("ERR: This command should have an argument descriptor in this position. | cmd: %d | cmd_index: %d | actual content: >0x%x<\n", t, cmd_index, this -> g_cmd_txt[t][cmd_index]);
 					this -> g_err = Err_codes::ERR_GENERIC;
-					DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+					DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+					TRACE_EXIT( TRACE_PARSER_EXE, TRACE_FAIL );
 					return true;	//fail
 				}
 				//The argument has been closed. I need to skip the argument descriptor "%?"
@@ -542,7 +579,8 @@ bool Uniparser::exe( uint8_t data )
 				{
 					//this should never happen
 					this -> g_err = Err_codes::ERR_GENERIC;
-					DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+					DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+					TRACE_EXIT( TRACE_PARSER_EXE, TRACE_FAIL );
 					return true;	//fail
 				}
 				//Issue execution of the callback function linked
@@ -592,7 +630,8 @@ bool Uniparser::exe( uint8_t data )
 				if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_cmd_txt[t] == nullptr))
 				{
 					this -> g_err = Err_codes::ERR_GENERIC;
-					DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+					DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+					TRACE_EXIT( TRACE_PARSER_EXE, TRACE_FAIL );
 					return true;	//fail
 				}
 				//If: partial match
@@ -659,7 +698,7 @@ bool Uniparser::exe( uint8_t data )
 							if ((UNIPARSER_PENDANTIC_CHECKS) && (f_ret == true))
 							{
 								this -> g_err = Err_codes::ERR_GENERIC;
-								DPRINT("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+								DPRINT_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 								//I can recover from this by resetting the FSM
 								f_rst_fsm = true;
 							}
@@ -720,7 +759,7 @@ bool Uniparser::exe( uint8_t data )
 					if ((UNIPARSER_PENDANTIC_CHECKS) && (f_ret == true))
 					{
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DPRINT("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DPRINT_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						//I can recover from this by resetting the FSM
 						f_rst_fsm = true;
 					}
@@ -730,7 +769,7 @@ bool Uniparser::exe( uint8_t data )
 					if ((UNIPARSER_PENDANTIC_CHECKS) && (f_ret == true))
 					{
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DPRINT("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DPRINT_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						//I can recover from this by resetting the FSM
 						f_rst_fsm = true;
 					}
@@ -747,7 +786,7 @@ bool Uniparser::exe( uint8_t data )
 			else
 			{
 				//I shouldn't have been in ID to begin with, but I can recover from this error
-				DPRINT("ERR: FSM was in ID matching but no partial matches were detected.\n");
+				DPRINT_ERR("ERR: FSM was in ID matching but no partial matches were detected.\n");
 				//Issue a FSM reset
 				f_rst_fsm = true;
 			}
@@ -837,7 +876,7 @@ bool Uniparser::exe( uint8_t data )
 			else
 			{
 				//I shouldn't have been in ID to begin with, but I can recover from this error
-				DPRINT("ERR: FSM was in ID matching but no partial matches were detected.\n");
+				DPRINT_ERR("ERR: FSM was in ID matching but no partial matches were detected.\n");
 				//Issue a FSM reset
 				f_rst_fsm = true;
 			}
@@ -861,7 +900,7 @@ bool Uniparser::exe( uint8_t data )
 			if ((UNIPARSER_PENDANTIC_CHECKS) && (f_ret == true))
 			{
 				this -> g_err = Err_codes::ERR_GENERIC;
-				DPRINT("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+				DPRINT_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 				//I can recover from this by resetting the FSM
 				f_rst_fsm = true;
 			}
@@ -878,7 +917,7 @@ bool Uniparser::exe( uint8_t data )
 			if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_num_match >= 0))
 			{
 				this -> g_err = Err_codes::ERR_GENERIC;
-				DPRINT("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+				DPRINT_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 				//I can recover from this by resetting the FSM
 				f_rst_fsm = true;
 			}
@@ -943,12 +982,23 @@ bool Uniparser::exe( uint8_t data )
 		if ((UNIPARSER_PENDANTIC_CHECKS) && (exe_index == this -> g_num_cmd))
 		{
 			this -> g_err = Err_codes::ERR_GENERIC;
-			DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+			DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+			TRACE_EXIT( TRACE_PARSER_EXE, TRACE_FAIL );
 			return true;	//fail
 		}
 		DPRINT("Executing handler of command %d | num arguments: %d\n", exe_index, this -> g_arg_fsm_status.num_arg);
+		TRACE_ENTER( TRACE_PARSER_HANDLER, exe_index );
 		//Execute handler of given function. Automatically deduce arguments from argument vector
-        this -> exe_handler( exe_index );
+		if (this -> exe_handler( exe_index ) == false)
+		{
+			//Count the executed command
+			this -> g_num_exe++;
+			TRACE_EXIT( TRACE_PARSER_HANDLER, TRACE_OK );
+		}
+		else
+		{
+			TRACE_EXIT( TRACE_PARSER_HANDLER, TRACE_FAIL );
+		}
         //Reset the argument decoder and prepare for a new command
 		this -> init_arg_decoder();
 	}	//If: a reset was issued
@@ -959,6 +1009,7 @@ bool Uniparser::exe( uint8_t data )
 
 	//Trace Return from main
 	DRETURN();
+	TRACE_EXIT( TRACE_PARSER_EXE, TRACE_OK );
 
 	return false;	//OK
 }	//end method:
@@ -986,6 +1037,7 @@ bool Uniparser::exe( uint8_t data )
 
 inline void Uniparser::init( void )
 {
+	DMODULE( DEBUG_PARSER_SETUP );
 	DENTER();
 
 	//----------------------------------------------------------------
@@ -1020,6 +1072,8 @@ inline void Uniparser::init( void )
 	this -> g_status = Orangebot::Parser_status::PARSER_IDLE;
 	//No error
 	this -> g_err = Orangebot::Err_codes::NO_ERR;
+	//No handler executed yet
+	this -> g_num_exe = 0;
 
 	//----------------------------------------------------------------
 	//	RETURN
@@ -1041,6 +1095,7 @@ inline void Uniparser::init( void )
 
 inline void Uniparser::init_arg_decoder( void )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	//Trace Enter with arguments
 	DENTER();
 
@@ -1086,6 +1141,7 @@ inline void Uniparser::init_arg_decoder( void )
 
 Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 {
+	DMODULE( DEBUG_PARSER_SETUP );
 	//Trace Enter with arguments
 	DENTER_ARG("cmd: %p\n", (void *)cmd);
 
@@ -1111,7 +1167,7 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 	if (cmd == nullptr)
 	{
 		err = Cmd_syntax_error::SYNTAX_BAD_POINTER;
-		DRETURN_ARG("ERR%d: | Bad handler function pointer\n", err);
+		DRETURN_ERR("ERR%d: | Bad handler function pointer\n", err);
 		return err;
 	}
 
@@ -1123,7 +1179,7 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 	if (!IS_LETTER(cmd[0]))
 	{
 		err = Cmd_syntax_error::SYNTAX_LENGTH;
-		DRETURN_ARG("ERR%d | First character of a command must be a letter\n", err);
+		DRETURN_ERR("ERR%d | First character of a command must be a letter\n", err);
 		return err;
 	}
 
@@ -1150,7 +1206,7 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 				{
 					err = Cmd_syntax_error::SYNTAX_ARG_TYPE_NOTSAME;
 					str = this -> decode_syntax_err( err );
-					DRETURN_ARG("ERR%d | %s\n", err, str);
+					DRETURN_ERR("ERR%d | %s\n", err, str);
 					return err;
 				}
 			}
@@ -1159,14 +1215,14 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 			{
 				err = Cmd_syntax_error::SYNTAX_ARG_TOOMANY;
 				str = this -> decode_syntax_err( err );
-				DRETURN_ARG("ERR%d | %s | max is two S32\n", err, str);
+				DRETURN_ERR("ERR%d | %s | max is two S32\n", err, str);
 				return err;
 			}
 			else if (arg_num > 4)
 			{
 				err = Cmd_syntax_error::SYNTAX_ARG_TOOMANY;
 				str = this -> decode_syntax_err( err );
-				DRETURN_ARG("ERR%d | %s | max is four S8 or U8 or S16 or U16\n", err, str);
+				DRETURN_ERR("ERR%d | %s | max is four S8 or U8 or S16 or U16\n", err, str);
 				return err;
 			}
 		}
@@ -1175,7 +1231,7 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 		{
 			err = Cmd_syntax_error::SYNTAX_ARG_TYPE_INVALID;
 			str = this -> decode_syntax_err( err );
-			DRETURN_ARG("ERR%d | %s | Valid arguments descriptors are: %c %c %c %c %c\n", err, str, Arg_descriptor::ARG_S8, Arg_descriptor::ARG_U8, Arg_descriptor::ARG_S16, Arg_descriptor::ARG_U16, Arg_descriptor::ARG_S32);
+			DRETURN_ERR("ERR%d | %s | Valid arguments descriptors are: %c %c %c %c %c\n", err, str, Arg_descriptor::ARG_S8, Arg_descriptor::ARG_U8, Arg_descriptor::ARG_S16, Arg_descriptor::ARG_U16, Arg_descriptor::ARG_S32);
 			return err;
 		}
 		//if: two arguments back to back
@@ -1183,7 +1239,7 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 		{
 			err = Cmd_syntax_error::SYNTAX_ARG_BACKTOBACK;
 			str = this -> decode_syntax_err( err );
-			DRETURN_ARG("ERR%d | %s\n", err, str);
+			DRETURN_ERR("ERR%d | %s\n", err, str);
 			return err;
 		}
 		//Parse next byte
@@ -1194,7 +1250,7 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 	{
 		err = Cmd_syntax_error::SYNTAX_LENGTH;
 		str = this -> decode_syntax_err( err );
-		DRETURN_ARG("ERR%d | %s\n", err, str );
+		DRETURN_ERR("ERR%d | %s\n", err, str );
 		return err;
 	}
 
@@ -1218,6 +1274,7 @@ Cmd_syntax_error Uniparser::chk_cmd( const uint8_t *cmd )
 
 const char *Uniparser::decode_syntax_err( Cmd_syntax_error cmd_err )
 {
+	DMODULE( DEBUG_PARSER_SETUP );
 	DENTER_ARG("err: %d\n", cmd_err);
 
 	//----------------------------------------------------------------
@@ -1307,6 +1364,7 @@ const char *Uniparser::decode_syntax_err( Cmd_syntax_error cmd_err )
 
 bool Uniparser::add_arg( uint8_t cmd_id )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	//Trace Enter with arguments
 	DENTER_ARG("command index: %d\n", cmd_id);
 
@@ -1329,7 +1387,7 @@ bool Uniparser::add_arg( uint8_t cmd_id )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (cmd_id > this -> g_num_cmd) )
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//Fetch index inside the command
@@ -1338,7 +1396,7 @@ bool Uniparser::add_arg( uint8_t cmd_id )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_cmd_txt[cmd_id][ cmd_index ] != '%'))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//Point to the argument type
@@ -1347,7 +1405,7 @@ bool Uniparser::add_arg( uint8_t cmd_id )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (!IS_ARG_DESCRIPTOR(this -> g_cmd_txt[cmd_id][ cmd_index ])) )
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1431,6 +1489,7 @@ bool Uniparser::add_arg( uint8_t cmd_id )
 
 inline bool Uniparser::set_s8( uint8_t arg_index, int8_t data )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	DENTER_ARG("arg_index: %d | data: %d\n", arg_index, data );
 
 	//----------------------------------------------------------------
@@ -1448,7 +1507,7 @@ inline bool Uniparser::set_s8( uint8_t arg_index, int8_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1456,7 +1515,7 @@ inline bool Uniparser::set_s8( uint8_t arg_index, int8_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index] != Arg_descriptor::ARG_S8))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1490,6 +1549,7 @@ inline bool Uniparser::set_s8( uint8_t arg_index, int8_t data )
 
 inline bool Uniparser::set_u8( uint8_t arg_index, uint8_t data )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	DENTER_ARG("arg_index: %d | data: %d\n", arg_index, data );
 
 	//----------------------------------------------------------------
@@ -1507,7 +1567,7 @@ inline bool Uniparser::set_u8( uint8_t arg_index, uint8_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1515,7 +1575,7 @@ inline bool Uniparser::set_u8( uint8_t arg_index, uint8_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index] != Arg_descriptor::ARG_U8))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1550,6 +1610,7 @@ inline bool Uniparser::set_u8( uint8_t arg_index, uint8_t data )
 
 inline bool Uniparser::set_s16( uint8_t arg_index, int16_t data )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	DENTER_ARG("arg_index: %d | data: %d\n", arg_index, data );
 
 	//----------------------------------------------------------------
@@ -1567,7 +1628,7 @@ inline bool Uniparser::set_s16( uint8_t arg_index, int16_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1575,7 +1636,7 @@ inline bool Uniparser::set_s16( uint8_t arg_index, int16_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index] != Arg_descriptor::ARG_S16))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1609,6 +1670,7 @@ inline bool Uniparser::set_s16( uint8_t arg_index, int16_t data )
 
 inline bool Uniparser::set_u16( uint8_t arg_index, uint16_t data )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	DENTER_ARG("arg_index: %d | data: %d\n", arg_index, data );
 
 	//----------------------------------------------------------------
@@ -1626,7 +1688,7 @@ inline bool Uniparser::set_u16( uint8_t arg_index, uint16_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1634,7 +1696,7 @@ inline bool Uniparser::set_u16( uint8_t arg_index, uint16_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index] != Arg_descriptor::ARG_U16))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1668,6 +1730,7 @@ inline bool Uniparser::set_u16( uint8_t arg_index, uint16_t data )
 
 inline bool Uniparser::set_s32( uint8_t arg_index, int32_t data )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	DENTER_ARG("arg_index: %d | data: %d\n", arg_index, data );
 
 	//----------------------------------------------------------------
@@ -1685,7 +1748,7 @@ inline bool Uniparser::set_s32( uint8_t arg_index, int32_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1693,7 +1756,7 @@ inline bool Uniparser::set_s32( uint8_t arg_index, int32_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index] != Arg_descriptor::ARG_S32))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1726,6 +1789,7 @@ inline bool Uniparser::set_s32( uint8_t arg_index, int32_t data )
 
 inline int8_t Uniparser::get_s8( uint8_t arg_index )
 {
+	DMODULE( DEBUG_PARSER_HANDLER );
 	DENTER_ARG("arg_index: %d\n", arg_index );
 
 	//----------------------------------------------------------------
@@ -1745,15 +1809,15 @@ inline int8_t Uniparser::get_s8( uint8_t arg_index )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (int8_t)0xff;	//fail
 	}
 	//If argument descriptor is bad
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index ] != Arg_descriptor::ARG_S8))
 	{
-		DPRINT("ERR: Expected S8 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S8, this -> g_arg[ arg_index ], arg_index);
+		DPRINT_ERR("ERR: Expected S8 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S8, this -> g_arg[ arg_index ], arg_index);
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (int8_t)0xff;	//fail
 	}
 
@@ -1786,6 +1850,7 @@ inline int8_t Uniparser::get_s8( uint8_t arg_index )
 
 inline uint8_t Uniparser::get_u8( uint8_t arg_index )
 {
+	DMODULE( DEBUG_PARSER_HANDLER );
 	DENTER_ARG("arg_index: %d\n", arg_index );
 
 	//----------------------------------------------------------------
@@ -1805,15 +1870,15 @@ inline uint8_t Uniparser::get_u8( uint8_t arg_index )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//If argument descriptor is bad
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index ] != Arg_descriptor::ARG_U8))
 	{
-		DPRINT("ERR: Expected U8 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_U8, this -> g_arg[ arg_index ], arg_index);
+		DPRINT_ERR("ERR: Expected U8 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_U8, this -> g_arg[ arg_index ], arg_index);
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -1846,6 +1911,7 @@ inline uint8_t Uniparser::get_u8( uint8_t arg_index )
 
 inline int16_t Uniparser::get_s16( uint8_t arg_index )
 {
+	DMODULE( DEBUG_PARSER_HANDLER );
 	DENTER_ARG("arg_index: %d\n", arg_index );
 
 	//----------------------------------------------------------------
@@ -1865,15 +1931,15 @@ inline int16_t Uniparser::get_s16( uint8_t arg_index )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (int16_t)0xffff;	//fail
 	}
 	//If argument descriptor is bad
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index ] != Arg_descriptor::ARG_S16))
 	{
-		DPRINT("ERR: Expected S16 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S16, this -> g_arg[ arg_index ], arg_index);
+		DPRINT_ERR("ERR: Expected S16 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S16, this -> g_arg[ arg_index ], arg_index);
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (int16_t)0xffff;	//fail
 	}
 
@@ -1906,6 +1972,7 @@ inline int16_t Uniparser::get_s16( uint8_t arg_index )
 
 uint16_t Uniparser::get_u16( uint8_t arg_index )
 {
+	DMODULE( DEBUG_PARSER_HANDLER );
 	DENTER_ARG("arg_index: %d\n", arg_index );
 
 	//----------------------------------------------------------------
@@ -1925,15 +1992,15 @@ uint16_t Uniparser::get_u16( uint8_t arg_index )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (uint16_t)0xffff;	//fail
 	}
 	//If argument descriptor is bad
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index ] != Arg_descriptor::ARG_U16))
 	{
-		DPRINT("ERR: Expected U16 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S16, this -> g_arg[ arg_index ], arg_index);
+		DPRINT_ERR("ERR: Expected U16 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S16, this -> g_arg[ arg_index ], arg_index);
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (uint16_t)0xffff;	//fail
 	}
 
@@ -1966,6 +2033,7 @@ uint16_t Uniparser::get_u16( uint8_t arg_index )
 
 int32_t Uniparser::get_s32( uint8_t arg_index )
 {
+	DMODULE( DEBUG_PARSER_HANDLER );
 	DENTER_ARG("arg_index: %d\n", arg_index );
 
 	//----------------------------------------------------------------
@@ -1985,15 +2053,15 @@ int32_t Uniparser::get_s32( uint8_t arg_index )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (int16_t)0xffff;	//fail
 	}
 	//If argument descriptor is bad
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[ arg_index ] != Arg_descriptor::ARG_S32))
 	{
-		DPRINT("ERR: Expected S32 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S32, this -> g_arg[ arg_index ], arg_index);
+		DPRINT_ERR("ERR: Expected S32 argument descriptor >0x%x< | Found instead: >0x%x< in index: %d\n", Arg_descriptor::ARG_S32, this -> g_arg[ arg_index ], arg_index);
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return (int16_t)0xffff;	//fail
 	}
 
@@ -2026,6 +2094,7 @@ int32_t Uniparser::get_s32( uint8_t arg_index )
 
 bool Uniparser::accumulate_arg( uint8_t data )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	//Trace Enter with arguments
 	DENTER_ARG("data >%c<\n", data);
 
@@ -2044,22 +2113,22 @@ bool Uniparser::accumulate_arg( uint8_t data )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( this -> g_arg_fsm_status.arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//If argument descriptor is bad
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (!IS_ARG_DESCRIPTOR(this -> g_arg[ this -> g_arg_fsm_status.arg_index ])))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//If: input char is bad
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (!IS_SIGN(data)) && (!IS_NUMBER(data)))
 	{
-		DPRINT("ERR: bad input char. Expecting number or sign and got >0x%x< instead\n", data);
+		DPRINT_ERR("ERR: bad input char. Expecting number or sign and got >0x%x< instead\n", data);
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -2237,7 +2306,7 @@ bool Uniparser::accumulate_arg( uint8_t data )
 		default:
 		{
 			this -> g_err = Err_codes::ERR_GENERIC;
-			DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+			DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 			return true;	//fail
 		}
 	}
@@ -2263,6 +2332,7 @@ bool Uniparser::accumulate_arg( uint8_t data )
 
 bool Uniparser::close_arg( void )
 {
+	DMODULE( DEBUG_PARSER_EXE );
 	//Trace Enter with arguments
 	DENTER();
 
@@ -2280,7 +2350,7 @@ bool Uniparser::close_arg( void )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && ( arg_index >= UNIPARSER_ARG_VECTOR_SIZE-2))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//Fetch argument descriptor
@@ -2289,7 +2359,7 @@ bool Uniparser::close_arg( void )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (!IS_ARG_DESCRIPTOR(arg_descriptor)))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -2321,7 +2391,7 @@ bool Uniparser::close_arg( void )
 	{
 		//This error means the argument descriptor was unrecognized
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;
 	}
 	else
@@ -2336,9 +2406,9 @@ bool Uniparser::close_arg( void )
 		//Restart the argument decoder
 		this -> init_arg_decoder();
 		//
-		DPRINT("ERR: Exceeded alloted argument vector size with index: %d\n", arg_index);
+		DPRINT_ERR("ERR: Exceeded alloted argument vector size with index: %d\n", arg_index);
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//Write back index
@@ -2369,6 +2439,7 @@ bool Uniparser::close_arg( void )
 
 bool Uniparser::exe_handler( uint8_t exe_index )
 {
+	DMODULE( DEBUG_PARSER_HANDLER );
 	//Trace Enter with arguments
 	DENTER_ARG("exe_index: %d\n", exe_index);
 
@@ -2383,9 +2454,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 	//if execution index is out of range.
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (exe_index == this -> g_num_cmd))
 	{
-		DPRINT("ERR: execution index is out of range\n");
+		DPRINT_ERR("ERR: execution index is out of range\n");
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 	//Fetch number of arguments
@@ -2394,7 +2465,7 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 	if ((UNIPARSER_PENDANTIC_CHECKS) && (num_arg > UNIPARSER_MAX_ARGS))
 	{
 		this -> g_err = Err_codes::ERR_GENERIC;
-		DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+		DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 		return true;	//fail
 	}
 
@@ -2453,9 +2524,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[index] != Arg_descriptor::ARG_S8))
 					{
-						DPRINT("ERR: argument is not >0x%x<. it's instead: >0x%x<", Arg_descriptor::ARG_S8, this -> g_arg[index]);
+						DPRINT_ERR("ERR: argument is not >0x%x<. it's instead: >0x%x<", Arg_descriptor::ARG_S8, this -> g_arg[index]);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 					//get first argument from argument vector
@@ -2465,9 +2536,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && ((index >= UNIPARSER_ARG_VECTOR_SIZE) || (index > UNIPARSER_MAX_ARG_INDEX)))
 					{
-						DPRINT("ERR: index is out of range: %d\n", index);
+						DPRINT_ERR("ERR: index is out of range: %d\n", index);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}
@@ -2523,7 +2594,7 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					default:
 					{
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}	//end switch number of arguments
@@ -2545,9 +2616,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[index] != Arg_descriptor::ARG_U8))
 					{
-						DPRINT("ERR: argument is not >0x%x<. it's instead: >0x%x<", Arg_descriptor::ARG_U8, this -> g_arg[index]);
+						DPRINT_ERR("ERR: argument is not >0x%x<. it's instead: >0x%x<", Arg_descriptor::ARG_U8, this -> g_arg[index]);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 					//get first argument from argument vector
@@ -2557,9 +2628,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && ((index >= UNIPARSER_ARG_VECTOR_SIZE) || (index > UNIPARSER_MAX_ARG_INDEX)))
 					{
-						DPRINT("ERR: index is out of range: %d\n", index);
+						DPRINT_ERR("ERR: index is out of range: %d\n", index);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}
@@ -2615,7 +2686,7 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					default:
 					{
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}	//end switch number of arguments
@@ -2637,9 +2708,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[index] != Arg_descriptor::ARG_S16))
 					{
-						DPRINT("ERR: argument is not >0x%x<. it's instead: >0x%x<\n", Arg_descriptor::ARG_S16, this -> g_arg[index]);
+						DPRINT_ERR("ERR: argument is not >0x%x<. it's instead: >0x%x<\n", Arg_descriptor::ARG_S16, this -> g_arg[index]);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 					//get first argument from argument vector
@@ -2649,9 +2720,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && ((index >= UNIPARSER_ARG_VECTOR_SIZE) || (index > UNIPARSER_MAX_ARG_INDEX)))
 					{
-						DPRINT("ERR: index is out of range: %d\n", index);
+						DPRINT_ERR("ERR: index is out of range: %d\n", index);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}
@@ -2707,7 +2778,7 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					default:
 					{
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}	//end switch number of arguments
@@ -2729,9 +2800,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[index] != Arg_descriptor::ARG_U16))
 					{
-						DPRINT("ERR: argument is not >0x%x<. it's instead: >0x%x<\n", Arg_descriptor::ARG_U16, this -> g_arg[index]);
+						DPRINT_ERR("ERR: argument is not >0x%x<. it's instead: >0x%x<\n", Arg_descriptor::ARG_U16, this -> g_arg[index]);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 					//get first argument from argument vector
@@ -2741,9 +2812,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && ((index >= UNIPARSER_ARG_VECTOR_SIZE) || (index > UNIPARSER_MAX_ARG_INDEX)))
 					{
-						DPRINT("ERR: index is out of range: %d\n", index);
+						DPRINT_ERR("ERR: index is out of range: %d\n", index);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}
@@ -2799,7 +2870,7 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					default:
 					{
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}	//end switch number of arguments
@@ -2821,9 +2892,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && (this -> g_arg[index] != Arg_descriptor::ARG_S32))
 					{
-						DPRINT("ERR: argument is not >0x%x<. it's instead: >0x%x<\n", Arg_descriptor::ARG_S32, this -> g_arg[index]);
+						DPRINT_ERR("ERR: argument is not >0x%x<. it's instead: >0x%x<\n", Arg_descriptor::ARG_S32, this -> g_arg[index]);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 					//get first argument from argument vector
@@ -2833,9 +2904,9 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					//if too many arguments have been deduced
 					if ((UNIPARSER_PENDANTIC_CHECKS) && ((index >= UNIPARSER_ARG_VECTOR_SIZE) || (index > UNIPARSER_MAX_ARG_INDEX)))
 					{
-						DPRINT("ERR: index is out of range: %d\n", index);
+						DPRINT_ERR("ERR: index is out of range: %d\n", index);
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}
@@ -2869,7 +2940,7 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 					default:
 					{
 						this -> g_err = Err_codes::ERR_GENERIC;
-						DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+						DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 						return true;	//fail
 					}
 				}	//end switch number of arguments
@@ -2880,7 +2951,7 @@ bool Uniparser::exe_handler( uint8_t exe_index )
 			default:
 			{
 				this -> g_err = Err_codes::ERR_GENERIC;
-				DRETURN_ARG("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
+				DRETURN_ERR("ERR%d: ERR_GENERIC in line: %d\n", this -> g_err, __LINE__ );
 				return true;	//fail
 			}
 		}	//end switch: decode the argument descriptor
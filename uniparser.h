@@ -53,6 +53,8 @@
 **	added guard against failure of set_
 **		>2019-10-09
 **	Fixed sign bug in add_cmd
+**		>2026-10-18
+**	added get_num_exe. Counts executed handlers so the caller can tell if a terminator ran a command
 **********************************************************************************/
 
 /**********************************************************************************
@@ -73,7 +75,7 @@
 //!redudant checks meant for debug only
 #define UNIPARSER_PENDANTIC_CHECKS	true
 //!Maximum number of commands that can be registered
-#define UNIPARSER_MAX_CMD			16
+#define UNIPARSER_MAX_CMD			32
 //!Commands can have at most two arguments
 #define UNIPARSER_MAX_ARGS			4
 //!Size of argument vector. one byte for each identifier plus bytes for the raw data
@@ -259,6 +261,8 @@ class Uniparser
 
 		//! Decode syntax error of the parser in string form. nullptr means no syntax error detected
 		const char *get_syntax_error( void );
+		//! Number of commands whose handler has been executed. Wraps around. Compare before and after exe to know if a command was run
+		uint8_t get_num_exe( void );
 
 		//--------------------------------------------------------------------------
 		//	TESTERS
@@ -362,6 +366,8 @@ class Uniparser
 		Parser_status g_status;
 		//Error status of the parser. NO_ERR means OK
 		Err_codes g_err;
+		//Number of handlers successfully executed. Wraps around
+		uint8_t g_num_exe;
 
 };	//End Class: Uniparser
 
@@ -0,0 +1,171 @@
+/****************************************************************
+**	OrangeBot Project
+*****************************************************************
+**	WATCHDOG
+*****************************************************************
+**	The WDT resets the AT4809 if the main loop hangs, e.g. in a
+**	handler that never returns, instead of leaving the motors at
+**	their last PWM.
+**
+**		HEARTBEATS
+**	Each periodic job of the main loop checks in with WDT_BEAT:
+**	WDT_BEAT_TICK	: scheduler_service served a system tick
+**	WDT_BEAT_RX		: uart_port_service drained the RX buffers
+**	WDT_BEAT_TX		: uart_port_service sent a byte or had nothing to send
+**	watchdog_service feeds the WDT only once all of them checked
+**	in since the last feed. A job that stops making progress for
+**	a WDT_PERIOD resets the board.
+**
+**		RESET CAUSE
+**	init_watchdog reads and clears RSTCTRL.RSTFR at boot.
+**	The heartbeats live in .noinit and survive a watchdog reset,
+**	so the RST query also tells which jobs were missing
+****************************************************************/
+
+/****************************************************************
+**	INCLUDES
+****************************************************************/
+
+#include "global.h"
+#ifdef __AVR__
+	//WDR instruction
+	#include <avr/wdt.h>
+#endif
+
+/****************************************************************
+** GLOBAL VARIABLES
+****************************************************************/
+
+//Heartbeats checked in since the last feed. Not cleared by the C runtime, survives a watchdog reset
+uint8_t g_wdt_beat __attribute__ ((section (".noinit")));
+//Reset flags of the last reset. RSTCTRL_xxx_bm
+uint8_t wdt_reset_flags = 0;
+//Heartbeats checked in before the last reset. Meaningful only after a watchdog reset
+uint8_t wdt_reset_beat = 0;
+
+/****************************************************************************
+**  Function
+**  init_watchdog
+****************************************************************************/
+//! @return void |
+//! @brief Record the cause of the last reset
+//! @details Called first thing at boot, before init enables the WDT.
+//!	The flags are cleared so that the next boot sees only its own cause
+/***************************************************************************/
+
+void init_watchdog( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	wdt_reset_flags = RSTCTRL.RSTFR;
+	//Flags are cleared by writing one
+	RSTCTRL.RSTFR = wdt_reset_flags;
+	//if: the watchdog reset the board. The heartbeats tell which job hung
+	if (IS_BIT_ONE( wdt_reset_flags, RSTCTRL_WDRF_bp ) == true)
+	{
+		wdt_reset_beat = g_wdt_beat;
+	}
+	g_wdt_beat = 0;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: init_watchdog
+
+/****************************************************************************
+**  Function
+**  watchdog_service
+****************************************************************************/
+//! @return void |
+//! @brief Feed the watchdog once all the heartbeats checked in
+//! @details Called by the main loop at every pass
+/***************************************************************************/
+
+void watchdog_service( void )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//if: every job made progress since the last feed
+	if ((g_wdt_beat & WDT_BEAT_ALL) == WDT_BEAT_ALL)
+	{
+		wdt_reset();
+		g_wdt_beat = 0;
+	}
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return;
+}	//End: watchdog_service
+
+/****************************************************************************
+**  Function
+**  reset_cause_reply | uint8_t, uint8_t *
+****************************************************************************/
+//! @param arg		| unused
+//! @param payload	| output. TELEMETRY_RESET_LEN bytes
+//! @return uint8_t | payload length
+//! @brief Build the payload of the reset cause frame
+//! @details
+//! | RSTFR | BEATS | CMDERR |
+//! RSTFR	: reset flags of the last boot. PORF, BORF, EXTRF, WDRF, SWRF, UPDIRF
+//! BEATS	: heartbeats checked in before a watchdog reset. A missing bit is the job that hung
+//! CMDERR	: commands the parser refused at boot. Must be 0
+/***************************************************************************/
+
+uint8_t reset_cause_reply( uint8_t arg, uint8_t *payload )
+{
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	(void)arg;
+	payload[0] = wdt_reset_flags;
+	payload[1] = wdt_reset_beat;
+	payload[2] = g_parser_err;
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return TELEMETRY_RESET_LEN;
+}	//End: reset_cause_reply
+
+/***************************************************************************/
+//!	@brief reset cause query handler
+//!	reset_cause_handler | void
+/***************************************************************************/
+//! @return void
+//!	@details
+//! Handler for the reset cause query. Answers with the reset cause frame, see reset_cause_reply
+/***************************************************************************/
+
+void reset_cause_handler( void )
+{
+	//----------------------------------------------------------------
+	//	INIT
+	//----------------------------------------------------------------
+
+	//Reset communication timeout handler
+	uart_timeout_cnt = 0;
+
+	//----------------------------------------------------------------
+	//	BODY
+	//----------------------------------------------------------------
+
+	//Answer on the port that asked, as soon as the TX buffer has room
+	send_reply( *g_uart_port_active, REPLY_RESET, 0 );
+
+	//----------------------------------------------------------------
+	//	RETURN
+	//----------------------------------------------------------------
+
+	return; //OK
+}	//end handler: reset_cause_handler | void